@@ -0,0 +1,231 @@
+// Microbenchmark for the main loop -> pulser handoff: the seqlock plan with a futex wake
+// used by edge-motion against the mutex/condvar state it replaced.
+//
+//   make bench            (or: cc -O2 -pthread bench/handoff.c -o handoff-bench)
+//
+// publish: cost of a plan update while the pulser is busy (speed changes mid-stroke)
+// read:    cost of the pulser taking a copy of the plan on every pulse
+// wake:    round trip from activating an idle pulser to it seeing the plan and answering
+#define _GNU_SOURCE
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define OPS 2000000
+#define WAKES 50000
+
+struct plan {
+    int edge_active;
+    int step_x;
+    int step_y;
+    int64_t interval_ns;
+};
+
+static inline int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Seqlock + futex, as in edge-motion.c.
+
+static struct {
+    _Atomic uint32_t seq;
+    _Atomic uint32_t wake;
+    _Atomic int edge_active;
+    _Atomic int step_x;
+    _Atomic int step_y;
+    _Atomic int64_t interval_ns;
+} sl;
+
+static void sl_write(const struct plan *p)
+{
+    uint32_t seq = atomic_load_explicit(&sl.seq, memory_order_relaxed);
+    atomic_store_explicit(&sl.seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&sl.edge_active, p->edge_active, memory_order_relaxed);
+    atomic_store_explicit(&sl.step_x, p->step_x, memory_order_relaxed);
+    atomic_store_explicit(&sl.step_y, p->step_y, memory_order_relaxed);
+    atomic_store_explicit(&sl.interval_ns, p->interval_ns, memory_order_relaxed);
+    atomic_store_explicit(&sl.seq, seq + 2, memory_order_release);
+}
+
+static void sl_read(struct plan *p)
+{
+    uint32_t begin;
+    uint32_t end;
+    do {
+        begin = atomic_load_explicit(&sl.seq, memory_order_acquire);
+        p->edge_active = atomic_load_explicit(&sl.edge_active, memory_order_relaxed);
+        p->step_x = atomic_load_explicit(&sl.step_x, memory_order_relaxed);
+        p->step_y = atomic_load_explicit(&sl.step_y, memory_order_relaxed);
+        p->interval_ns = atomic_load_explicit(&sl.interval_ns, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        end = atomic_load_explicit(&sl.seq, memory_order_relaxed);
+    } while ((begin & 1U) || begin != end);
+}
+
+static void sl_wake(void)
+{
+    atomic_fetch_add_explicit(&sl.wake, 1, memory_order_release);
+    syscall(SYS_futex, (uint32_t *)&sl.wake, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT_MAX, NULL, NULL, 0);
+}
+
+// Mutex + condvar, as before the seqlock.
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct plan plan;
+} mx = {.lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER};
+
+static void mx_write(const struct plan *p, int signal)
+{
+    pthread_mutex_lock(&mx.lock);
+    mx.plan = *p;
+    if (signal)
+        pthread_cond_signal(&mx.cond);
+    pthread_mutex_unlock(&mx.lock);
+}
+
+static void mx_read(struct plan *p)
+{
+    pthread_mutex_lock(&mx.lock);
+    *p = mx.plan;
+    pthread_mutex_unlock(&mx.lock);
+}
+
+// Busy reader standing in for a pulser that copies the plan on every tick.
+
+static _Atomic int reader_stop;
+static _Atomic int use_mutex;
+
+static void *busy_reader(void *arg)
+{
+    (void)arg;
+    struct plan p;
+    volatile int sink = 0;
+    while (!atomic_load_explicit(&reader_stop, memory_order_relaxed)) {
+        if (atomic_load_explicit(&use_mutex, memory_order_relaxed))
+            mx_read(&p);
+        else
+            sl_read(&p);
+        sink += p.step_x;
+    }
+    return NULL;
+}
+
+static double bench_publish(int mutex)
+{
+    atomic_store(&reader_stop, 0);
+    atomic_store(&use_mutex, mutex);
+    pthread_t thr;
+    pthread_create(&thr, NULL, busy_reader, NULL);
+
+    struct plan p = {.edge_active = 1, .interval_ns = 10000000};
+    int64_t start = now_ns();
+    for (int i = 0; i < OPS; i++) {
+        p.step_x = i;
+        if (mutex)
+            mx_write(&p, 1);
+        else
+            sl_write(&p);
+    }
+    int64_t elapsed = now_ns() - start;
+
+    atomic_store(&reader_stop, 1);
+    pthread_join(thr, NULL);
+    return (double)elapsed / OPS;
+}
+
+static double bench_read(int mutex)
+{
+    struct plan p;
+    volatile int sink = 0;
+    int64_t start = now_ns();
+    for (int i = 0; i < OPS; i++) {
+        if (mutex)
+            mx_read(&p);
+        else
+            sl_read(&p);
+        sink += p.step_x;
+    }
+    return (double)(now_ns() - start) / OPS;
+}
+
+// Ping-pong: the main thread activates (step_x = round), the sleeper answers on "ack".
+
+static _Atomic uint32_t ack;
+
+static void *sleeper(void *arg)
+{
+    int mutex = (int)(intptr_t)arg;
+    for (int round = 1; round <= WAKES; round++) {
+        struct plan p;
+        if (mutex) {
+            pthread_mutex_lock(&mx.lock);
+            while (mx.plan.step_x != round)
+                pthread_cond_wait(&mx.cond, &mx.lock);
+            pthread_mutex_unlock(&mx.lock);
+        } else {
+            for (;;) {
+                uint32_t wake = atomic_load_explicit(&sl.wake, memory_order_acquire);
+                sl_read(&p);
+                if (p.step_x == round)
+                    break;
+                syscall(SYS_futex, (uint32_t *)&sl.wake, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG, wake, NULL, NULL,
+                        FUTEX_BITSET_MATCH_ANY);
+            }
+        }
+        atomic_store_explicit(&ack, (uint32_t)round, memory_order_release);
+        syscall(SYS_futex, (uint32_t *)&ack, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, NULL, NULL, 0);
+    }
+    return NULL;
+}
+
+static double bench_wake(int mutex)
+{
+    struct plan p = {.edge_active = 1, .interval_ns = 10000000};
+    sl_write(&p);
+    mx_write(&p, 0);
+    atomic_store(&ack, 0);
+
+    pthread_t thr;
+    pthread_create(&thr, NULL, sleeper, (void *)(intptr_t)mutex);
+    usleep(10000);
+
+    int64_t start = now_ns();
+    for (int round = 1; round <= WAKES; round++) {
+        p.step_x = round;
+        if (mutex) {
+            mx_write(&p, 1);
+        } else {
+            sl_write(&p);
+            sl_wake();
+        }
+        uint32_t seen;
+        while ((seen = atomic_load_explicit(&ack, memory_order_acquire)) != (uint32_t)round)
+            syscall(SYS_futex, (uint32_t *)&ack, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, seen, NULL, NULL, 0);
+    }
+    int64_t elapsed = now_ns() - start;
+
+    pthread_join(thr, NULL);
+    return (double)elapsed / WAKES;
+}
+
+int main(void)
+{
+    printf("%-10s %14s %14s\n", "", "seqlock+futex", "mutex+condvar");
+    printf("%-10s %11.1f ns %11.1f ns\n", "publish", bench_publish(0), bench_publish(1));
+    printf("%-10s %11.1f ns %11.1f ns\n", "read", bench_read(0), bench_read(1));
+    printf("%-10s %11.1f us %11.1f us\n", "wake rtt", bench_wake(0) / 1000.0, bench_wake(1) / 1000.0);
+    return 0;
+}
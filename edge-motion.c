@@ -3,58 +3,129 @@
 #include <ctype.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <limits.h>
 #include <libevdev/libevdev.h>
 #include <math.h>
+#include <linux/futex.h>
 #include <linux/uinput.h>
 #include <poll.h>
 #include <pthread.h>
 #include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <strings.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
-#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
 #include <time.h>
 #include <libudev.h>
 #include <unistd.h>
 
+// USDT probes (provider "edge_motion") for bpftrace/perf. They cost one nop each and need
+// <sys/sdt.h> (systemtap-sdt-dev) at build time; without it, or with -DEDGE_MOTION_NO_SDT,
+// they compile to nothing.
+#if !defined(EDGE_MOTION_NO_SDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define EM_HAVE_SDT 1
+#endif
+#endif
+
+#ifdef EM_HAVE_SDT
+#define EM_PROBE1(name, a) DTRACE_PROBE1(edge_motion, name, a)
+#define EM_PROBE2(name, a, b) DTRACE_PROBE2(edge_motion, name, a, b)
+#define EM_PROBE4(name, a, b, c, d) DTRACE_PROBE4(edge_motion, name, a, b, c, d)
+#define EM_PROBE5(name, a, b, c, d, e) DTRACE_PROBE5(edge_motion, name, a, b, c, d, e)
+#else
+#define EM_PROBE1(name, a) do { } while (0)
+#define EM_PROBE2(name, a, b) do { } while (0)
+#define EM_PROBE4(name, a, b, c, d) do { } while (0)
+#define EM_PROBE5(name, a, b, c, d, e) do { } while (0)
+#endif
+
 #define EDGE_MOTION_VERSION "1.3.3"
 
 #define DEFAULT_EDGE_THRESHOLD 0.06
 #define DEFAULT_EDGE_HYSTERESIS 0.015
 #define DEFAULT_HOLD_MS 80
 #define DEFAULT_PULSE_MS 10
+#define MIN_PULSE_US 100
+#define MAX_PULSE_US 1000000
+#define VELOCITY_MAX_DT_PULSES 4
+// Top speed with --velocity, the per-pulse cap of 100 units at the default pulse interval.
+#define MAX_VELOCITY (100.0 * 1000.0 / DEFAULT_PULSE_MS)
+#define DEFAULT_MAX_PULSE_US 50000
 #define DEFAULT_PULSE_STEP 1.5
 #define DEFAULT_MAX_SPEED 3.0
 #define TOUCHPAD_DISCONNECT_TIMEOUT_MS 200
 #define TOUCHPAD_REOPEN_POLL_MS 250
+// Reopen retries after a disconnect or an "add" uevent while a udev monitor is active, in
+// case the device was not ready yet; the delay doubles each time, then the monitor alone wakes us.
+#define TOUCHPAD_HOTPLUG_RETRY_MS 500
+#define TOUCHPAD_HOTPLUG_RETRIES 3
 #define UINPUT_SETTLE_MS 50
+#define UINPUT_RETRY_MS 500
 #define RESOURCE_CHECK_INTERVAL_MS 1000
+// Readable by an unprivileged exporter; the daemon itself usually runs as root.
+#define DEFAULT_METRICS_SOCKET_MODE 0666
+#define RESOURCE_EMITTER_RESTARTS 2
+// How long a restart waits for the old pulser to exit before giving up on it.
+#define PULSER_JOIN_TIMEOUT_MS 500
 #define DEFAULT_MAX_RSS_MB 256
 #define DEFAULT_MAX_CPU_PERCENT 90.0
 #define DEFAULT_RESOURCE_GRACE_CHECKS 5
+#define DEFAULT_DEVICE_CACHE_PATH "/var/cache/edge-motion/touchpad"
+#define WHEEL_HI_RES_PER_DETENT 120
+#define STEP_FRAC_BITS 16
+#define STEP_ONE (1 << STEP_FRAC_BITS)
+#define MAX_PLAN_STEP ((double)(INT_MAX / STEP_ONE))
+
+#ifndef REL_WHEEL_HI_RES
+#define REL_WHEEL_HI_RES 0x0b
+#endif
+#ifndef REL_HWHEEL_HI_RES
+#define REL_HWHEEL_HI_RES 0x0c
+#endif
 
 static double edge_threshold = DEFAULT_EDGE_THRESHOLD;
 static double edge_hysteresis = DEFAULT_EDGE_HYSTERESIS;
 static int hold_ms = DEFAULT_HOLD_MS;
-static int pulse_ms = DEFAULT_PULSE_MS;
+static int pulse_us = DEFAULT_PULSE_MS * 1000;
 static double pulse_step = DEFAULT_PULSE_STEP;
+static double velocity = 0.0;
+static int adaptive_rate = 0;
+static int min_pulse_us = 0;
+static int max_pulse_us = DEFAULT_MAX_PULSE_US;
 static double max_speed = DEFAULT_MAX_SPEED;
 static int verbose = 0;
 static int list_devices = 0;
+static const char *decode_flight_path = NULL;
+static int self_test = 0;
 static int use_grab = 0;
 static char *forced_devnode = NULL;
 static int diagonal_scroll = 0;
 static int natural_scroll = 0;
+static int hires_scroll = 1;
 static int two_finger_scroll = 0;
 static double deadzone = 0.0;
 static double threshold_left = -1.0;
 static double threshold_right = -1.0;
 static double threshold_top = -1.0;
 static double threshold_bottom = -1.0;
+static double button_zone = 0.0;
+static int button_cooldown_ms = 0;
 static double accel_exponent = 1.0;
 static double pressure_boost = 0.0;
 static int daemon_mode = 0;
@@ -68,6 +139,16 @@ static double max_cpu_percent = DEFAULT_MAX_CPU_PERCENT;
 static int resource_grace_checks = DEFAULT_RESOURCE_GRACE_CHECKS;
 static char **ignored_devnodes = NULL;
 static size_t ignored_devnode_count = 0;
+static int event_loop_mode = 0;
+static int raw_reader_mode = 0;
+static int catch_up_mode = 0;
+static int latency_stats = 0;
+static int event_clock_monotonic = 0;
+static char *device_cache_path = NULL;
+static char *metrics_socket_path = NULL;
+static int metrics_socket_mode = DEFAULT_METRICS_SOCKET_MODE;
+static char *flight_record_path = NULL;
+static int device_cache_enabled = 1;
 
 enum em_mode {
     EM_MODE_MOTION = 0,
@@ -85,14 +166,56 @@ enum scroll_priority {
 static enum scroll_priority scroll_priority = SCROLL_PRIORITY_DOMINANT;
 
 static volatile sig_atomic_t running = 1;
+static volatile sig_atomic_t latency_dump_requested = 0;
+static volatile sig_atomic_t flight_dump_requested = 0;
 
-struct em_state {
-    pthread_mutex_t lock;
-    pthread_cond_t cond;
+struct emission_plan {
     int edge_active;
-    int dir_x;
-    int dir_y;
-    double speed_factor;
+    int mode;
+    // When the plan was published, for --latency-stats; 0 otherwise.
+    int64_t published_ns;
+    // Per-pulse step in 1/STEP_ONE units (REL units or wheel detents); the emitter carries
+    // the fraction over to the next pulse.
+    int step_x;
+    int step_y;
+    int64_t interval_ns;
+};
+
+// Single-writer seqlock: the frame processor publishes a precomputed emission plan and the
+// emitter copies it out without a lock. `wake` is the futex word the pulser sleeps on.
+struct em_state {
+    _Atomic uint32_t seq;
+    _Atomic uint32_t wake;
+    _Atomic int edge_active;
+    _Atomic int mode;
+    _Atomic int step_x;
+    _Atomic int step_y;
+    _Atomic int64_t interval_ns;
+    _Atomic int64_t published_ns;
+    // Writer-only copy of the last published inputs, used for change detection.
+    int last_edge_active;
+    int last_dir_x;
+    int last_dir_y;
+    double last_speed_factor;
+    int last_mode;
+    double last_speed_scale;
+};
+
+// Emitter-side state: the uinput fd, the sub-unit step remainder per axis and the hi-res
+// wheel remainder not yet reported as a legacy detent.
+struct emitter {
+    int ufd;
+    int mode;
+    // published_ns of the last plan whose pickup was measured.
+    int64_t seen_published_ns;
+    // Time of the previous pulse, for --velocity; 0 until the first pulse after activation.
+    int64_t last_pulse_ns;
+    int64_t step_acc_x;
+    int64_t step_acc_y;
+    int wheel_acc_x;
+    int wheel_acc_y;
+    // After a uinput failure the device is recreated no earlier than this.
+    int64_t retry_at_ns;
 };
 
 struct touchpad_resources {
@@ -101,34 +224,348 @@ struct touchpad_resources {
     struct libevdev *dev;
 };
 
+#define EMIT_FRAME_MAX 8
+
+struct emit_frame {
+    struct input_event events[EMIT_FRAME_MAX];
+    size_t count;
+};
+
+// write() calls against events delivered shows the syscalls saved by frame batching.
+struct emit_stats {
+    _Atomic uint64_t events;
+    _Atomic uint64_t write_calls;
+    _Atomic uint64_t eagain_retries;
+    _Atomic uint64_t write_errors;
+    // Pulse deadlines that had already passed when the emitter got to them.
+    _Atomic uint64_t skipped_ticks;
+    _Atomic uint64_t pulses;
+    // Pulser futex returns, or pulse timer expirations handled by the event loop.
+    _Atomic uint64_t wakeups;
+};
+
+// Main loop counters for --metrics-socket; written by the main thread only.
+struct input_stats {
+    _Atomic uint64_t events;
+    _Atomic uint64_t frames;
+    _Atomic uint64_t activations;
+    _Atomic uint64_t reconnects;
+    _Atomic uint64_t wakeups;
+};
+
+#define LATENCY_BUCKETS 32
+
+enum latency_stage {
+    LAT_EVDEV_TO_READ,
+    LAT_READ_TO_CLASSIFY,
+    LAT_PUBLISH_TO_EMITTER,
+    LAT_EMIT_WRITE,
+    LAT_PULSE_JITTER,
+    LAT_STAGE_COUNT,
+};
+
+// Bucket b counts samples of [2^(b-1), 2^b) ns; the last one also takes everything longer.
+// Main loop and emitter record with relaxed atomics only, so a dump may be a sample off.
+struct latency_hist {
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum_ns;
+    _Atomic uint64_t max_ns;
+    _Atomic uint64_t buckets[LATENCY_BUCKETS];
+};
+
+struct touch_tracker {
+    int *slot_x;
+    int *slot_y;
+    unsigned char *slot_active;
+    int32_t *mt_sync_buf;
+    int slot_count;
+    int current_slot;
+    int preferred_slot;
+    int active_fingers;
+    int last_x;
+    int last_y;
+    int last_pressure;
+    int touch_contact;
+    int buttons_down_mask;
+    // End of the --button-cooldown-ms pause after the latest button change, same clock as
+    // event_time_ms.
+    int64_t button_cooldown_until_ms;
+    int double_tap_active;
+    int tap_count;
+    int64_t last_tap_time_ms;
+    // Kernel timestamp of the latest event, CLOCK_MONOTONIC ms (see event_time_ms()).
+    int64_t event_time_ms;
+    // Kernel timestamp of the latest SYN_REPORT in ns, 0 unless the clock is CLOCK_MONOTONIC.
+    int64_t frame_time_ns;
+    int tap_start_x;
+    int tap_start_y;
+    int was_in_edge;
+    int was_in_edge_x;
+    int was_in_edge_y;
+    int has_mt_tracking_id;
+    int has_btn_touch;
+    int has_touch_tool_keys;
+    int has_touch_contact_key;
+    int has_pressure;
+};
+
+#define RAW_EVENT_BATCH 64
+
+struct slot_code {
+    int slot;
+    unsigned int code;
+};
+
+struct raw_reader {
+    struct input_event events[RAW_EVENT_BATCH];
+    unsigned char stale[RAW_EVENT_BATCH];
+    int dropped;
+    uint64_t coalesced;
+};
+
+struct touchpad_identity {
+    char devnode[PATH_MAX];
+    char syspath[PATH_MAX];
+    char name[256];
+    int vendor;
+    int product;
+    int min_x;
+    int max_x;
+    int min_y;
+    int max_y;
+};
+
 struct touchpad_candidate {
     char *devnode;
     char *name;
     int integrated;
+    int width_mm;
+    int height_mm;
+    long long area;
+};
+
+struct sysfs_bitmap {
+    unsigned long words[KEY_CNT / (sizeof(unsigned long) * 8) + 1];
+    size_t count;
+};
+
+#define EDGE_DEPTH_SHIFT 16
+#define EDGE_DEPTH_ONE (1 << EDGE_DEPTH_SHIFT)
+#define SPEED_LUT_BITS 8
+#define SPEED_LUT_SIZE ((1 << SPEED_LUT_BITS) + 1)
+#define ACCEL_CURVE_MAX_POINTS 32
+
+struct accel_point {
+    double depth;
+    double factor;
+};
+
+#define ZONE_GRID_SIZE 16
+
+// A rectangle in normalized touchpad coordinates. A zone with no direction excludes its area
+// from edge activation; otherwise it overrides the edge direction and can switch the output
+// mode (-1 keeps --mode) and scale the step.
+struct edge_zone {
+    double x0;
+    double y0;
+    double x1;
+    double y1;
+    int dx;
+    int dy;
+    int mode;
+    double speed;
+    int dev_x0;
+    int dev_y0;
+    int dev_x1;
+    int dev_y1;
+};
+
+// Grid cells covered by one zone, inclusive; only needed while the grid is built.
+struct zone_cell_span {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+};
+
+// Zones compiled per device into a coarse grid: cell_start/cell_zones hold, for each cell, the
+// indices of the zones overlapping it in priority order (compressed rows).
+struct zone_grid {
     int min_x;
-    int max_x;
     int min_y;
-    int max_y;
-    long long area;
+    int64_t span_x;
+    int64_t span_y;
+    int cell_start[ZONE_GRID_SIZE * ZONE_GRID_SIZE + 1];
+    int *cell_zones;
+};
+
+// One axis of the edge classifier in device units. The boundaries are where the normalized
+// threshold comparisons flip; the depth ramps are stored in fixed point so that depth is a
+// subtraction and one multiply. Coordinates are clamped to [lo, hi] first.
+struct edge_axis {
+    int lo;
+    int hi;
+    int dead_lo;
+    int dead_hi;
+    int low_enter;
+    int low_leave;
+    int high_enter;
+    int high_leave;
+    int64_t low_origin_q16;
+    int64_t high_origin_q16;
+    int64_t low_mult;
+    int64_t high_mult;
+};
+
+struct edge_table {
+    struct edge_axis x;
+    struct edge_axis y;
+    // First y of the --button-zone strip, INT_MAX when there is none.
+    int button_zone_y;
+};
+
+enum guard_target {
+    GUARD_TARGET_MAIN,
+    GUARD_TARGET_PULSER,
+    // RSS is shared by all threads, so memory violations go to the process.
+    GUARD_TARGET_PROCESS,
+    GUARD_TARGET_COUNT,
+};
+
+enum guard_action {
+    GUARD_STOP = -1,
+    GUARD_OK = 0,
+    GUARD_RESTART_EMITTER = 1,
 };
 
 struct resource_guard_state {
     double last_cpu_seconds;
+    // Per-thread CPU time at the previous sample, indexed by guard_target (main, pulser).
+    double last_thread_cpu[2];
     struct timespec last_ts;
     int initialized;
     int consecutive_over_limit;
+    int emitter_restarts;
 };
 
-static inline int64_t timespec_to_ms(const struct timespec *ts);
+// CPU clocks of the daemon's threads; the pulser's changes when the guard restarts it.
+struct thread_clocks {
+    clockid_t main;
+    _Atomic clockid_t pulser;
+    _Atomic int has_pulser;
+};
+
+struct guard_stats {
+    _Atomic uint64_t violations[GUARD_TARGET_COUNT];
+    _Atomic uint64_t emitter_restarts;
+    // Per-thread CPU share at the last sample, in hundredths of a percent.
+    _Atomic int64_t thread_cpu_x100[2];
+};
+
+struct hotplug_monitor {
+    struct udev *udev;
+    struct udev_monitor *monitor;
+    int fd;
+};
+
+struct event_loop {
+    int epoll_fd;
+    int signal_fd;
+    int pulse_fd;
+    int guard_fd;
+    int input_fd;
+    int pulse_armed;
+    int64_t pulse_interval_ns;
+    // Next expected timer expiration, tracked only for --latency-stats.
+    int64_t pulse_deadline_ns;
+};
 
-static struct em_state state = {
-    .lock = PTHREAD_MUTEX_INITIALIZER,
-    .edge_active = 0,
-    .dir_x = 0,
-    .dir_y = 0,
-    .speed_factor = 0.0,
+#define FLIGHT_RECORD_SIZE 4096
+#define FLIGHT_RECORD_MAGIC "EMFLIGHT"
+#define FLIGHT_RECORD_VERSION 2
+// FLIGHT_EMIT packs an event's type and code into one value: type << 16 | code.
+#define FLIGHT_EVENT_ID(ev) ((int32_t)((uint32_t)(ev).type << 16 | (ev).code))
+#define FLIGHT_EVENT_NONE (-1)
+
+enum flight_kind {
+    FLIGHT_FRAME = 1,
+    FLIGHT_PUBLISH,
+    FLIGHT_EMIT,
+    FLIGHT_EMIT_ERROR,
+    FLIGHT_GUARD_TRIP,
 };
 
+// Ring slot: seq is index + 1 once the entry is complete and 0 while a writer fills it, so a
+// dump can drop entries torn by a concurrent write.
+struct flight_slot {
+    _Atomic uint32_t seq;
+    _Atomic uint32_t kind;
+    _Atomic int64_t time_ns;
+    _Atomic int32_t v[4];
+};
+
+struct flight_recorder {
+    _Atomic uint64_t head;
+    struct flight_slot slots[FLIGHT_RECORD_SIZE];
+};
+
+// On-disk dump: the header, then count entries oldest first, in host byte order.
+struct flight_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    int64_t dump_time_ns;
+};
+
+struct flight_file_entry {
+    int64_t time_ns;
+    uint32_t kind;
+    int32_t v[4];
+    uint32_t reserved;
+};
+
+struct metrics_server {
+    int listen_fd;
+    // eventfd that tells the accept thread to exit.
+    int stop_fd;
+    pthread_t thread;
+    int thread_started;
+    int bound;
+};
+
+#define METRICS_BUF_SIZE 8192
+
+struct metrics_buf {
+    char data[METRICS_BUF_SIZE];
+    size_t len;
+};
+
+static inline int64_t timespec_to_ms(const struct timespec *ts);
+static inline int64_t monotonic_now_ns(void);
+
+static struct em_state state;
+static struct edge_table edge_table = {.button_zone_y = INT_MAX};
+static struct accel_point accel_curve[ACCEL_CURVE_MAX_POINTS];
+static size_t accel_curve_points = 0;
+static struct edge_zone *zones = NULL;
+static size_t zone_count = 0;
+static struct zone_grid zone_grid;
+// Speed factor per quantized edge depth, and the pressure boost multiplier per quantized
+// pressure, both in EDGE_DEPTH_ONE units.
+static int32_t accel_lut[SPEED_LUT_SIZE];
+static int32_t pressure_lut[SPEED_LUT_SIZE];
+static struct emit_stats emit_stats;
+static struct input_stats input_stats;
+static struct flight_recorder *flight_recorder = NULL;
+static struct thread_clocks thread_clocks;
+static struct guard_stats guard_stats;
+static _Atomic int pulser_stop;
+// /proc/self/statm, opened once and read with pread() by the guard and the metrics thread,
+// with its page size in KiB, also set once before any of those threads start.
+static int statm_fd = -1;
+static long statm_page_kb = -1;
+static struct latency_hist latency_hist[LAT_STAGE_COUNT];
+
 static int parse_mode(const char *value, enum em_mode *out)
 {
     if (strcmp(value, "motion") == 0) {
@@ -241,38 +678,315 @@ static int parse_bool_arg(const char *value, int *out)
     return -1;
 }
 
-static int read_rss_kb(void)
+// Piecewise-linear acceleration: "depth:factor" pairs, comma or space separated, with depth
+// strictly increasing and both values in 0..1, e.g. "0:0,0.4:0.1,1:1".
+static int parse_accel_curve(const char *value)
 {
-    FILE *fp = fopen("/proc/self/statm", "r");
-    if (!fp)
+    char *copy = strdup(value);
+    if (!copy)
+        return -1;
+
+    size_t count = 0;
+    int rc = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(copy, ", \t", &save); tok; tok = strtok_r(NULL, ", \t", &save)) {
+        char *colon = strchr(tok, ':');
+        if (!colon || count >= ACCEL_CURVE_MAX_POINTS) {
+            rc = -1;
+            break;
+        }
+        *colon = '\0';
+        double depth = 0.0;
+        double factor = 0.0;
+        if (parse_double_arg(tok, &depth) < 0 || parse_double_arg(colon + 1, &factor) < 0 || depth < 0.0 ||
+            depth > 1.0 || factor < 0.0 || factor > 1.0 || (count > 0 && depth <= accel_curve[count - 1].depth)) {
+            rc = -1;
+            break;
+        }
+        accel_curve[count].depth = depth;
+        accel_curve[count].factor = factor;
+        count++;
+    }
+    free(copy);
+
+    if (rc < 0 || count == 0)
+        return -1;
+    accel_curve_points = count;
+    return 0;
+}
+
+static int parse_zone_direction(const char *value, int *dx, int *dy)
+{
+    static const struct {
+        const char *name;
+        int dx;
+        int dy;
+    } dirs[] = {
+        {"left", -1, 0},     {"right", 1, 0},     {"up", 0, -1},        {"down", 0, 1},
+        {"up-left", -1, -1}, {"up-right", 1, -1}, {"down-left", -1, 1}, {"down-right", 1, 1},
+        {"exclude", 0, 0},
+    };
+    for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+        if (strcmp(value, dirs[i].name) == 0) {
+            *dx = dirs[i].dx;
+            *dy = dirs[i].dy;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// "x0,y0,x1,y1,direction[,motion|scroll][,speed]" with coordinates normalized to 0..1;
+// direction is left/right/up/down, a diagonal such as up-left, or exclude. Zones given first
+// take priority where they overlap.
+static int add_zone(const char *value)
+{
+    char *copy = strdup(value);
+    if (!copy)
+        return -1;
+
+    struct edge_zone zone = {.mode = -1, .speed = 1.0};
+    double *coords[] = {&zone.x0, &zone.y0, &zone.x1, &zone.y1};
+    int field = 0;
+    int rc = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(copy, ",", &save); tok && rc == 0; tok = strtok_r(NULL, ",", &save), field++) {
+        enum em_mode zone_mode;
+        if (field < 4)
+            rc = parse_double_arg(tok, coords[field]);
+        else if (field == 4)
+            rc = parse_zone_direction(tok, &zone.dx, &zone.dy);
+        else if (field < 7 && parse_mode(tok, &zone_mode) == 0)
+            zone.mode = zone_mode;
+        else if (field < 7)
+            rc = parse_double_arg(tok, &zone.speed);
+        else
+            rc = -1;
+    }
+    free(copy);
+
+    if (rc < 0 || field < 5 || zone.x0 < 0.0 || zone.y0 < 0.0 || zone.x1 > 1.0 || zone.y1 > 1.0 ||
+        zone.x0 >= zone.x1 || zone.y0 >= zone.y1 || zone.speed <= 0.0 || zone.speed > 10.0)
+        return -1;
+
+    struct edge_zone *tmp = realloc(zones, (zone_count + 1) * sizeof(*zones));
+    if (!tmp)
+        return -1;
+    zones = tmp;
+    zones[zone_count++] = zone;
+    return 0;
+}
+
+static void free_zones(void)
+{
+    free(zone_grid.cell_zones);
+    zone_grid.cell_zones = NULL;
+    free(zones);
+    zones = NULL;
+    zone_count = 0;
+}
+
+// --pulse-ms is kept for existing configs and is stored as microseconds.
+static int parse_pulse_ms_arg(const char *value)
+{
+    int ms = 0;
+    if (parse_int_arg(value, &ms) < 0 || ms <= 0 || ms > INT_MAX / 1000)
+        return -1;
+    pulse_us = ms * 1000;
+    return 0;
+}
+
+static const char *guard_target_name(int target)
+{
+    switch (target) {
+    case GUARD_TARGET_MAIN:
+        return "main";
+    case GUARD_TARGET_PULSER:
+        return "pulser";
+    case GUARD_TARGET_PROCESS:
+        return "process";
+    }
+    return "?";
+}
+
+static void handle_flight_dump_signal(int sig)
+{
+    (void)sig;
+    flight_dump_requested = 1;
+}
+
+// Any thread may record; slots are claimed with one atomic increment, nothing blocks.
+static void flight_record(enum flight_kind kind, int32_t a, int32_t b, int32_t c, int32_t d)
+{
+    struct flight_recorder *fr = flight_recorder;
+    if (!fr)
+        return;
+
+    uint64_t idx = atomic_fetch_add_explicit(&fr->head, 1, memory_order_relaxed);
+    struct flight_slot *slot = &fr->slots[idx % FLIGHT_RECORD_SIZE];
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&slot->kind, kind, memory_order_relaxed);
+    atomic_store_explicit(&slot->time_ns, monotonic_now_ns(), memory_order_relaxed);
+    atomic_store_explicit(&slot->v[0], a, memory_order_relaxed);
+    atomic_store_explicit(&slot->v[1], b, memory_order_relaxed);
+    atomic_store_explicit(&slot->v[2], c, memory_order_relaxed);
+    atomic_store_explicit(&slot->v[3], d, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, (uint32_t)idx + 1, memory_order_release);
+}
+
+static int write_all(int fd, const void *data, size_t size)
+{
+    const char *p = data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+static void flight_dump(const char *reason)
+{
+    struct flight_recorder *fr = flight_recorder;
+    if (!fr)
+        return;
+
+    // The pulser and the main thread may dump at the same time: each writes its own temporary
+    // file and renames it into place, so the dump on disk is always one complete snapshot.
+    int saved_errno = errno;
+    char tmp_path[PATH_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", flight_record_path, (long)syscall(SYS_gettid));
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to write flight record %s: %s\n", tmp_path, strerror(errno));
+        errno = saved_errno;
+        return;
+    }
+
+    uint64_t head = atomic_load_explicit(&fr->head, memory_order_acquire);
+    uint64_t first = head > FLIGHT_RECORD_SIZE ? head - FLIGHT_RECORD_SIZE : 0;
+    struct flight_file_header header = {.version = FLIGHT_RECORD_VERSION, .dump_time_ns = monotonic_now_ns()};
+    memcpy(header.magic, FLIGHT_RECORD_MAGIC, sizeof(header.magic));
+    // The count is patched in once the entries that survived are known.
+    int ok = write_all(fd, &header, sizeof(header)) == 0;
+
+    for (uint64_t idx = first; ok && idx < head; idx++) {
+        struct flight_slot *slot = &fr->slots[idx % FLIGHT_RECORD_SIZE];
+        uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq != (uint32_t)idx + 1)
+            continue;
+        struct flight_file_entry entry = {
+            .time_ns = atomic_load_explicit(&slot->time_ns, memory_order_relaxed),
+            .kind = atomic_load_explicit(&slot->kind, memory_order_relaxed),
+        };
+        for (int i = 0; i < 4; i++)
+            entry.v[i] = atomic_load_explicit(&slot->v[i], memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq)
+            continue;
+        ok = write_all(fd, &entry, sizeof(entry)) == 0;
+        header.count++;
+    }
+
+    if (ok)
+        ok = pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    if (close(fd) != 0)
+        ok = 0;
+    if (ok)
+        ok = rename(tmp_path, flight_record_path) == 0;
+    if (!ok) {
+        unlink(tmp_path);
+        fprintf(stderr, "Failed to write flight record %s\n", flight_record_path);
+    }
+    else if (verbose)
+        fprintf(stderr, "Flight record (%s): %u entries written to %s\n", reason, header.count, flight_record_path);
+    errno = saved_errno;
+}
+
+static int decode_flight_record(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
         return -1;
+    }
 
-    unsigned long total_pages = 0;
-    unsigned long rss_pages = 0;
-    if (fscanf(fp, "%lu %lu", &total_pages, &rss_pages) != 2) {
+    struct flight_file_header header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, FLIGHT_RECORD_MAGIC, 8) != 0 ||
+        header.version != FLIGHT_RECORD_VERSION) {
+        fprintf(stderr, "%s is not an edge-motion flight record.\n", path);
         fclose(fp);
         return -1;
     }
+
+    printf("%u entries, times relative to the dump at %.6f s (CLOCK_MONOTONIC)\n", header.count,
+           (double)header.dump_time_ns / 1e9);
+    struct flight_file_entry e;
+    for (uint32_t i = 0; i < header.count && fread(&e, sizeof(e), 1, fp) == 1; i++) {
+        printf("%12.3f ms  ", (double)(e.time_ns - header.dump_time_ns) / 1e6);
+        switch (e.kind) {
+        case FLIGHT_FRAME:
+            printf("frame       slot=%d x=%d y=%d fingers=%d\n", e.v[0], e.v[1], e.v[2], e.v[3]);
+            break;
+        case FLIGHT_PUBLISH:
+            printf("publish     active=%d dx=%d dy=%d speed=%.3f\n", e.v[0], e.v[1], e.v[2], e.v[3] / 1000.0);
+            break;
+        case FLIGHT_EMIT:
+            printf("emit        type %d code %d=%d", e.v[0] >> 16, e.v[0] & 0xffff, e.v[1]);
+            if (e.v[2] != FLIGHT_EVENT_NONE)
+                printf(", type %d code %d=%d", e.v[2] >> 16, e.v[2] & 0xffff, e.v[3]);
+            printf("\n");
+            break;
+        case FLIGHT_EMIT_ERROR:
+            printf("emit-error  %s\n", strerror(e.v[0]));
+            break;
+        case FLIGHT_GUARD_TRIP:
+            printf("guard-trip  cpu=%.2f%% rss=%dkB thread=%s\n", e.v[0] / 100.0, e.v[1],
+                   guard_target_name(e.v[2]));
+            break;
+        default:
+            printf("unknown     kind=%u %d %d %d %d\n", e.kind, e.v[0], e.v[1], e.v[2], e.v[3]);
+            break;
+        }
+    }
+
     fclose(fp);
-    (void)total_pages;
+    return 0;
+}
 
-    long page_size = sysconf(_SC_PAGESIZE);
-    if (page_size <= 0)
+static int read_rss_kb(void)
+{
+    if (statm_fd < 0 || statm_page_kb <= 0)
+        return -1;
+
+    // "size resident shared ..." in pages; pread keeps the fd usable from any thread.
+    char buf[128];
+    ssize_t n = pread(statm_fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0)
+        return -1;
+    buf[n] = '\0';
+
+    char *end = NULL;
+    strtoul(buf, &end, 10);
+    char *rss_end = NULL;
+    unsigned long rss_pages = strtoul(end, &rss_end, 10);
+    if (rss_end == end)
         return -1;
 
-    unsigned long long rss_bytes = (unsigned long long)rss_pages * (unsigned long long)page_size;
-    return (int)(rss_bytes / 1024ULL);
+    return (int)(rss_pages * (unsigned long)statm_page_kb);
 }
 
-static double read_cpu_seconds(void)
+static double thread_cpu_seconds(clockid_t clock)
 {
-    struct rusage usage;
-    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) < 0)
         return -1.0;
-
-    double user = (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec / 1000000.0;
-    double sys = (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec / 1000000.0;
-    return user + sys;
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
 }
 
 static void maybe_show_resource_error_dialog(const char *message)
@@ -290,29 +1004,26 @@ static void maybe_show_resource_error_dialog(const char *message)
     _exit(0);
 }
 
-static int check_resource_limits(struct resource_guard_state *guard)
+static int sample_resource_usage(struct resource_guard_state *guard, const struct timespec *now)
 {
-    if (!resource_guard_enabled)
-        return 0;
-
-    struct timespec now;
-    clock_gettime(CLOCK_MONOTONIC, &now);
-    int64_t now_ms = timespec_to_ms(&now);
-    if (guard->initialized) {
-        int64_t elapsed_ms = now_ms - timespec_to_ms(&guard->last_ts);
-        if (elapsed_ms < RESOURCE_CHECK_INTERVAL_MS)
-            return 0;
-    }
-
+    int64_t now_ms = timespec_to_ms(now);
     int rss_kb = read_rss_kb();
-    double cpu_seconds = read_cpu_seconds();
+    double cpu_seconds = thread_cpu_seconds(CLOCK_PROCESS_CPUTIME_ID);
+    double thread_cpu[2] = {
+        thread_cpu_seconds(thread_clocks.main),
+        atomic_load_explicit(&thread_clocks.has_pulser, memory_order_acquire)
+            ? thread_cpu_seconds(atomic_load_explicit(&thread_clocks.pulser, memory_order_relaxed))
+            : -1.0,
+    };
 
     if (!guard->initialized) {
-        guard->last_ts = now;
+        guard->last_ts = *now;
         guard->last_cpu_seconds = cpu_seconds;
+        guard->last_thread_cpu[0] = thread_cpu[0];
+        guard->last_thread_cpu[1] = thread_cpu[1];
         guard->initialized = 1;
         guard->consecutive_over_limit = 0;
-        return 0;
+        return GUARD_OK;
     }
 
     double elapsed_s = (double)(now_ms - timespec_to_ms(&guard->last_ts)) / 1000.0;
@@ -322,9 +1033,19 @@ static int check_resource_limits(struct resource_guard_state *guard)
     double cpu_percent = 0.0;
     if (cpu_seconds >= 0.0 && guard->last_cpu_seconds >= 0.0)
         cpu_percent = (cpu_seconds - guard->last_cpu_seconds) / elapsed_s * 100.0;
+    double thread_percent[2] = {0.0, 0.0};
+    for (int i = 0; i < 2; i++) {
+        if (thread_cpu[i] >= 0.0 && guard->last_thread_cpu[i] >= 0.0)
+            thread_percent[i] = (thread_cpu[i] - guard->last_thread_cpu[i]) / elapsed_s * 100.0;
+        guard->last_thread_cpu[i] = thread_cpu[i];
+        atomic_store_explicit(&guard_stats.thread_cpu_x100[i], (int64_t)(thread_percent[i] * 100.0),
+                              memory_order_relaxed);
+    }
 
-    guard->last_ts = now;
+    guard->last_ts = *now;
     guard->last_cpu_seconds = cpu_seconds;
+    // CPU in hundredths of a percent.
+    EM_PROBE2(guard_sample, (int)(cpu_percent * 100.0), rss_kb);
 
     int rss_limit_kb = max_rss_mb > 0 ? max_rss_mb * 1024 : 0;
     int rss_over = rss_limit_kb > 0 && rss_kb > 0 && rss_kb > rss_limit_kb;
@@ -333,24 +1054,62 @@ static int check_resource_limits(struct resource_guard_state *guard)
     if (rss_over || cpu_over) {
         guard->consecutive_over_limit++;
         if (guard->consecutive_over_limit >= resource_grace_checks) {
+            // CPU goes to whichever thread used most of it; in --event-loop mode that is main.
+            int target = rss_over ? GUARD_TARGET_PROCESS
+                                  : thread_percent[GUARD_TARGET_PULSER] > thread_percent[GUARD_TARGET_MAIN]
+                                        ? GUARD_TARGET_PULSER
+                                        : GUARD_TARGET_MAIN;
+            atomic_fetch_add_explicit(&guard_stats.violations[target], 1, memory_order_relaxed);
+            flight_record(FLIGHT_GUARD_TRIP, (int32_t)(cpu_percent * 100.0), rss_kb, target, 0);
+            flight_dump("resource guard");
+
+            // A spinning emitter is replaced rather than taking the daemon down with it.
+            if (target == GUARD_TARGET_PULSER && guard->emitter_restarts < RESOURCE_EMITTER_RESTARTS) {
+                guard->emitter_restarts++;
+                guard->consecutive_over_limit = 0;
+                fprintf(stderr, "Pulser thread at %.1f%% CPU (limit %.1f%%), restarting the emitter (%d/%d).\n",
+                        thread_percent[GUARD_TARGET_PULSER], max_cpu_percent, guard->emitter_restarts,
+                        RESOURCE_EMITTER_RESTARTS);
+                return GUARD_RESTART_EMITTER;
+            }
+
             char msg[512];
             snprintf(msg,
                      sizeof(msg),
-                     "edge-motion остановлен: повышенное потребление ресурсов.\n"
-                     "CPU: %.1f%% (лимит %.1f%%), RSS: %.1f MB (лимит %d MB).",
+                     "edge-motion остановлен: повышенное потребление ресурсов (поток %s).\n"
+                     "CPU: %.1f%% (main %.1f%%, pulser %.1f%%; лимит %.1f%%), RSS: %.1f MB (лимит %d MB).",
+                     guard_target_name(target),
                      cpu_percent,
+                     thread_percent[GUARD_TARGET_MAIN],
+                     thread_percent[GUARD_TARGET_PULSER],
                      max_cpu_percent,
                      rss_kb > 0 ? (double)rss_kb / 1024.0 : -1.0,
                      max_rss_mb);
             fprintf(stderr, "%s\n", msg);
             maybe_show_resource_error_dialog(msg);
-            return -1;
+            return GUARD_STOP;
         }
     } else {
         guard->consecutive_over_limit = 0;
     }
 
-    return 0;
+    return GUARD_OK;
+}
+
+static int check_resource_limits(struct resource_guard_state *guard)
+{
+    if (!resource_guard_enabled)
+        return GUARD_OK;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (guard->initialized) {
+        int64_t elapsed_ms = timespec_to_ms(&now) - timespec_to_ms(&guard->last_ts);
+        if (elapsed_ms < RESOURCE_CHECK_INTERVAL_MS)
+            return GUARD_OK;
+    }
+
+    return sample_resource_usage(guard, &now);
 }
 
 
@@ -368,6 +1127,59 @@ static int set_forced_devnode(const char *value)
     return 0;
 }
 
+static int set_device_cache_path(const char *value)
+{
+    if (!value || value[0] != '/')
+        return -1;
+
+    char *copy = strdup(value);
+    if (!copy)
+        return -1;
+
+    free(device_cache_path);
+    device_cache_path = copy;
+    return 0;
+}
+
+static int set_metrics_socket_path(const char *value)
+{
+    if (!value || value[0] != '/')
+        return -1;
+
+    char *copy = strdup(value);
+    if (!copy)
+        return -1;
+
+    free(metrics_socket_path);
+    metrics_socket_path = copy;
+    return 0;
+}
+
+static int set_metrics_socket_mode(const char *value)
+{
+    char *end = NULL;
+    errno = 0;
+    long parsed = strtol(value, &end, 8);
+    if (errno != 0 || !end || end == value || *end != '\0' || parsed < 0 || parsed > 0777)
+        return -1;
+    metrics_socket_mode = (int)parsed;
+    return 0;
+}
+
+static int set_flight_record_path(const char *value)
+{
+    if (!value || value[0] != '/')
+        return -1;
+
+    char *copy = strdup(value);
+    if (!copy)
+        return -1;
+
+    free(flight_record_path);
+    flight_record_path = copy;
+    return 0;
+}
+
 static int apply_config_option(const char *key, const char *value)
 {
     if (strcmp(key, "threshold") == 0)
@@ -382,12 +1194,26 @@ static int apply_config_option(const char *key, const char *value)
         return parse_double_arg(value, &threshold_bottom);
     if (strcmp(key, "hysteresis") == 0)
         return parse_double_arg(value, &edge_hysteresis);
+    if (strcmp(key, "button-zone") == 0)
+        return parse_double_arg(value, &button_zone);
+    if (strcmp(key, "button-cooldown-ms") == 0)
+        return parse_int_arg(value, &button_cooldown_ms);
     if (strcmp(key, "hold-ms") == 0)
         return parse_int_arg(value, &hold_ms);
     if (strcmp(key, "pulse-ms") == 0)
-        return parse_int_arg(value, &pulse_ms);
+        return parse_pulse_ms_arg(value);
+    if (strcmp(key, "pulse-us") == 0)
+        return parse_int_arg(value, &pulse_us);
     if (strcmp(key, "pulse-step") == 0)
         return parse_double_arg(value, &pulse_step);
+    if (strcmp(key, "velocity") == 0)
+        return parse_double_arg(value, &velocity);
+    if (strcmp(key, "adaptive-rate") == 0)
+        return parse_bool_arg(value, &adaptive_rate);
+    if (strcmp(key, "min-pulse-us") == 0)
+        return parse_int_arg(value, &min_pulse_us);
+    if (strcmp(key, "max-pulse-us") == 0)
+        return parse_int_arg(value, &max_pulse_us);
     if (strcmp(key, "max-speed") == 0)
         return parse_double_arg(value, &max_speed);
     if (strcmp(key, "mode") == 0)
@@ -395,6 +1221,8 @@ static int apply_config_option(const char *key, const char *value)
     if (strcmp(key, "natural-scroll") == 0) {
         return parse_bool_arg(value, &natural_scroll);
     }
+    if (strcmp(key, "hires-scroll") == 0)
+        return parse_bool_arg(value, &hires_scroll);
     if (strcmp(key, "diagonal-scroll") == 0) {
         return parse_bool_arg(value, &diagonal_scroll);
     }
@@ -425,6 +1253,10 @@ static int apply_config_option(const char *key, const char *value)
         return parse_scroll_priority(value, &scroll_priority);
     if (strcmp(key, "accel-exponent") == 0)
         return parse_double_arg(value, &accel_exponent);
+    if (strcmp(key, "accel-curve") == 0)
+        return parse_accel_curve(value);
+    if (strcmp(key, "zone") == 0)
+        return add_zone(value);
     if (strcmp(key, "pressure-boost") == 0)
         return parse_double_arg(value, &pressure_boost);
     if (strcmp(key, "double-tap-hold") == 0)
@@ -435,6 +1267,28 @@ static int apply_config_option(const char *key, const char *value)
         return parse_int_arg(value, &double_tap_max_window_ms);
     if (strcmp(key, "tap-move-threshold") == 0)
         return parse_int_arg(value, &tap_move_threshold);
+    if (strcmp(key, "event-loop") == 0)
+        return parse_bool_arg(value, &event_loop_mode);
+    if (strcmp(key, "raw-reader") == 0)
+        return parse_bool_arg(value, &raw_reader_mode);
+    if (strcmp(key, "catch-up") == 0)
+        return parse_bool_arg(value, &catch_up_mode);
+    if (strcmp(key, "latency-stats") == 0)
+        return parse_bool_arg(value, &latency_stats);
+    if (strcmp(key, "metrics-socket") == 0)
+        return set_metrics_socket_path(value);
+    if (strcmp(key, "metrics-socket-mode") == 0)
+        return set_metrics_socket_mode(value);
+    if (strcmp(key, "flight-recorder") == 0)
+        return set_flight_record_path(value);
+    if (strcmp(key, "device-cache") == 0) {
+        if (strcasecmp(value, "off") == 0 || strcasecmp(value, "no") == 0) {
+            device_cache_enabled = 0;
+            return 0;
+        }
+        device_cache_enabled = 1;
+        return set_device_cache_path(value);
+    }
 
     return -1;
 }
@@ -490,16 +1344,101 @@ static void handle_signal(int sig)
     running = 0;
 }
 
-static inline int emit_event(int ufd, int type, int code, int val)
+static void handle_latency_dump_signal(int sig)
 {
-    struct input_event ev = {0};
-    ev.type = type;
-    ev.code = code;
-    ev.value = val;
+    (void)sig;
+    latency_dump_requested = 1;
+}
+
+static void latency_record(enum latency_stage stage, int64_t ns)
+{
+    struct latency_hist *h = &latency_hist[stage];
+    uint64_t v = ns > 0 ? (uint64_t)ns : 0;
+    int bucket = v ? 64 - __builtin_clzll(v) : 0;
+    if (bucket >= LATENCY_BUCKETS)
+        bucket = LATENCY_BUCKETS - 1;
+
+    atomic_fetch_add_explicit(&h->buckets[bucket], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum_ns, v, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+    while (v > max && !atomic_compare_exchange_weak_explicit(&h->max_ns, &max, v, memory_order_relaxed,
+                                                              memory_order_relaxed))
+        ;
+}
+
+static void format_latency(char *buf, size_t size, double ns)
+{
+    if (ns < 1000.0)
+        snprintf(buf, size, "%.0fns", ns);
+    else if (ns < 1000000.0)
+        snprintf(buf, size, "%.1fus", ns / 1000.0);
+    else
+        snprintf(buf, size, "%.2fms", ns / 1000000.0);
+}
+
+static void dump_latency_stats(FILE *out)
+{
+    static const char *const names[LAT_STAGE_COUNT] = {
+        [LAT_EVDEV_TO_READ] = "evdev->read",
+        [LAT_READ_TO_CLASSIFY] = "read->classify",
+        [LAT_PUBLISH_TO_EMITTER] = "publish->emitter",
+        [LAT_EMIT_WRITE] = "uinput write",
+        [LAT_PULSE_JITTER] = "pulse jitter",
+    };
+
+    for (int stage = 0; stage < LAT_STAGE_COUNT; stage++) {
+        struct latency_hist *h = &latency_hist[stage];
+        uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+        if (count == 0) {
+            fprintf(out, "latency %s: no samples\n", names[stage]);
+            continue;
+        }
+
+        char mean[16];
+        char max[16];
+        format_latency(mean, sizeof(mean),
+                       (double)atomic_load_explicit(&h->sum_ns, memory_order_relaxed) / (double)count);
+        format_latency(max, sizeof(max), (double)atomic_load_explicit(&h->max_ns, memory_order_relaxed));
+        fprintf(out, "latency %s: %llu samples, mean %s, max %s\n", names[stage], (unsigned long long)count,
+                mean, max);
+        for (int b = 0; b < LATENCY_BUCKETS; b++) {
+            uint64_t n = atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+            if (n == 0)
+                continue;
+            int last = b == LATENCY_BUCKETS - 1;
+            char bound[16];
+            format_latency(bound, sizeof(bound), (double)(1ULL << (last ? b - 1 : b)));
+            fprintf(out, "  %s %-9s %llu\n", last ? ">=" : "< ", bound, (unsigned long long)n);
+        }
+    }
+    fflush(out);
+}
+
+static inline void frame_add(struct emit_frame *frame, int type, int code, int val)
+{
+    if (frame->count >= EMIT_FRAME_MAX)
+        return;
+
+    struct input_event *ev = &frame->events[frame->count++];
+    memset(ev, 0, sizeof(*ev));
+    ev->type = type;
+    ev->code = code;
+    ev->value = val;
+}
+
+// Submits the whole frame (REL codes plus SYN_REPORT) with a single write(); uinput accepts
+// any number of events per call, so the loop only repeats after a short write or EAGAIN.
+static int emit_frame(int ufd, const struct emit_frame *frame)
+{
+    const char *buf = (const char *)frame->events;
+    size_t total = frame->count * sizeof(struct input_event);
     size_t written = 0;
+    int64_t start_ns = latency_stats ? monotonic_now_ns() : 0;
 
-    while (written < sizeof(ev)) {
-        ssize_t ret = write(ufd, (const char *)&ev + written, sizeof(ev) - written);
+    while (written < total) {
+        ssize_t ret = write(ufd, buf + written, total - written);
+        atomic_fetch_add_explicit(&emit_stats.write_calls, 1, memory_order_relaxed);
         if (ret > 0) {
             written += (size_t)ret;
             continue;
@@ -509,27 +1448,26 @@ static inline int emit_event(int ufd, int type, int code, int val)
             continue;
 
         if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            atomic_fetch_add_explicit(&emit_stats.eagain_retries, 1, memory_order_relaxed);
+            EM_PROBE2(uinput_retry, written, total);
+            // A restart or shutdown must not wait for a queue that never drains.
+            if (!running || atomic_load_explicit(&pulser_stop, memory_order_relaxed))
+                return -1;
             struct timespec ts = {.tv_sec = 0, .tv_nsec = 1000000};
             nanosleep(&ts, NULL);
             continue;
         }
 
+        atomic_fetch_add_explicit(&emit_stats.write_errors, 1, memory_order_relaxed);
         return -1;
     }
 
+    atomic_fetch_add_explicit(&emit_stats.events, frame->count, memory_order_relaxed);
+    if (latency_stats)
+        latency_record(LAT_EMIT_WRITE, monotonic_now_ns() - start_ns);
     return 0;
 }
 
-static inline int emit_rel(int ufd, int code, int val)
-{
-    return emit_event(ufd, EV_REL, code, val);
-}
-
-static inline int emit_syn(int ufd)
-{
-    return emit_event(ufd, EV_SYN, SYN_REPORT, 0);
-}
-
 static inline int64_t timespec_to_ms(const struct timespec *ts)
 {
     return ts->tv_sec * 1000LL + ts->tv_nsec / 1000000LL;
@@ -542,6 +1480,35 @@ static inline int64_t monotonic_now_ms(void)
     return timespec_to_ms(&now);
 }
 
+static inline int64_t monotonic_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static inline void ns_to_timespec(int64_t ns, struct timespec *ts)
+{
+    ts->tv_sec = (time_t)(ns / 1000000000LL);
+    ts->tv_nsec = (long)(ns % 1000000000LL);
+}
+
+// Gesture timing follows the kernel's event timestamps once EVIOCSCLOCKID switched them to
+// CLOCK_MONOTONIC; without that they are wall-clock time, so the processing time is used.
+static inline int64_t event_time_ms(const struct input_event *ev)
+{
+    if (!event_clock_monotonic)
+        return monotonic_now_ms();
+    return (int64_t)ev->input_event_sec * 1000LL + (int64_t)ev->input_event_usec / 1000LL;
+}
+
+static inline int64_t event_time_ns(const struct input_event *ev)
+{
+    if (!event_clock_monotonic)
+        return 0;
+    return (int64_t)ev->input_event_sec * 1000000000LL + (int64_t)ev->input_event_usec * 1000LL;
+}
+
 static int is_touch_tool_key(int code)
 {
     return code == BTN_TOOL_FINGER || code == BTN_TOOL_DOUBLETAP ||
@@ -549,19 +1516,7 @@ static int is_touch_tool_key(int code)
            code == BTN_TOOL_QUINTTAP;
 }
 
-static int has_touch_contact_signal(struct libevdev *dev)
-{
-    return libevdev_has_event_code(dev, EV_ABS, ABS_MT_TRACKING_ID) ||
-           libevdev_has_event_code(dev, EV_KEY, BTN_TOUCH) ||
-           libevdev_has_event_code(dev, EV_KEY, BTN_TOOL_FINGER) ||
-           libevdev_has_event_code(dev, EV_KEY, BTN_TOOL_DOUBLETAP) ||
-           libevdev_has_event_code(dev, EV_KEY, BTN_TOOL_TRIPLETAP) ||
-           libevdev_has_event_code(dev, EV_KEY, BTN_TOOL_QUADTAP) ||
-           libevdev_has_event_code(dev, EV_KEY, BTN_TOOL_QUINTTAP);
-}
-
-static int reset_multitouch_state(struct libevdev *dev, int **slot_x, int **slot_y,
-                                  unsigned char **slot_active, int *slot_count)
+static int reset_multitouch_state(struct libevdev *dev, struct touch_tracker *tt)
 {
     const struct input_absinfo *slot_info = libevdev_get_abs_info(dev, ABS_MT_SLOT);
     int new_slot_count = 1;
@@ -572,10 +1527,13 @@ static int reset_multitouch_state(struct libevdev *dev, int **slot_x, int **slot
     int *new_slot_x = calloc((size_t)new_slot_count, sizeof(int));
     int *new_slot_y = calloc((size_t)new_slot_count, sizeof(int));
     unsigned char *new_slot_active = calloc((size_t)new_slot_count, sizeof(unsigned char));
-    if (!new_slot_x || !new_slot_y || !new_slot_active) {
+    // EVIOCGMTSLOTS layout: one code word followed by one value per slot.
+    int32_t *new_mt_sync_buf = calloc((size_t)new_slot_count + 1, sizeof(int32_t));
+    if (!new_slot_x || !new_slot_y || !new_slot_active || !new_mt_sync_buf) {
         free(new_slot_x);
         free(new_slot_y);
         free(new_slot_active);
+        free(new_mt_sync_buf);
         return -1;
     }
 
@@ -584,18 +1542,452 @@ static int reset_multitouch_state(struct libevdev *dev, int **slot_x, int **slot
         new_slot_y[i] = -1;
     }
 
-    free(*slot_x);
-    free(*slot_y);
-    free(*slot_active);
+    free(tt->slot_x);
+    free(tt->slot_y);
+    free(tt->slot_active);
+    free(tt->mt_sync_buf);
+
+    tt->slot_x = new_slot_x;
+    tt->slot_y = new_slot_y;
+    tt->slot_active = new_slot_active;
+    tt->mt_sync_buf = new_mt_sync_buf;
+    tt->slot_count = new_slot_count;
+
+    return 0;
+}
+
+static void free_multitouch_state(struct touch_tracker *tt)
+{
+    free(tt->slot_x);
+    free(tt->slot_y);
+    free(tt->slot_active);
+    free(tt->mt_sync_buf);
+    tt->slot_x = NULL;
+    tt->slot_y = NULL;
+    tt->slot_active = NULL;
+    tt->mt_sync_buf = NULL;
+    tt->slot_count = 0;
+}
+
+static void read_touch_capabilities(struct libevdev *dev, struct touch_tracker *tt)
+{
+    tt->has_mt_tracking_id = libevdev_has_event_code(dev, EV_ABS, ABS_MT_TRACKING_ID);
+    tt->has_btn_touch = libevdev_has_event_code(dev, EV_KEY, BTN_TOUCH);
+    tt->has_touch_tool_keys = libevdev_has_event_code(dev, EV_KEY, BTN_TOOL_FINGER) ||
+                              libevdev_has_event_code(dev, EV_KEY, BTN_TOOL_DOUBLETAP) ||
+                              libevdev_has_event_code(dev, EV_KEY, BTN_TOOL_TRIPLETAP) ||
+                              libevdev_has_event_code(dev, EV_KEY, BTN_TOOL_QUADTAP) ||
+                              libevdev_has_event_code(dev, EV_KEY, BTN_TOOL_QUINTTAP);
+    tt->has_touch_contact_key = tt->has_btn_touch || tt->has_touch_tool_keys;
+    tt->has_pressure = libevdev_has_event_code(dev, EV_ABS, ABS_MT_PRESSURE);
+}
+
+static void reset_touch_contact(struct touch_tracker *tt)
+{
+    tt->last_x = -1;
+    tt->last_y = -1;
+    tt->was_in_edge = 0;
+    tt->was_in_edge_x = 0;
+    tt->was_in_edge_y = 0;
+    tt->active_fingers = 0;
+    tt->touch_contact = 0;
+    tt->buttons_down_mask = 0;
+    tt->double_tap_active = 0;
+    tt->tap_count = 0;
+    tt->last_tap_time_ms = 0;
+    tt->tap_start_x = -1;
+    tt->tap_start_y = -1;
+}
+
+static void reset_touch_tracker(struct touch_tracker *tt)
+{
+    reset_touch_contact(tt);
+    tt->current_slot = 0;
+    tt->preferred_slot = -1;
+    tt->last_pressure = -1;
+}
+
+static void register_touch_start(struct touch_tracker *tt)
+{
+    if (!double_tap_hold_mode)
+        return;
+
+    int64_t diff = tt->event_time_ms - tt->last_tap_time_ms;
+    if (tt->tap_count == 1 && diff >= double_tap_min_window_ms && diff <= double_tap_max_window_ms) {
+        tt->double_tap_active = 1;
+    } else {
+        tt->double_tap_active = 0;
+        tt->tap_count = 0;
+    }
+    tt->tap_start_x = -1;
+    tt->tap_start_y = -1;
+}
+
+static void register_touch_release(struct touch_tracker *tt)
+{
+    if (double_tap_hold_mode) {
+        if (tt->double_tap_active) {
+            tt->double_tap_active = 0;
+            tt->tap_count = 0;
+            tt->last_tap_time_ms = 0;
+        } else {
+            // Any short release within window counts as potential first tap
+            tt->tap_count = 1;
+            tt->last_tap_time_ms = tt->event_time_ms;
+        }
+    }
+
+    tt->last_x = -1;
+    tt->last_y = -1;
+    tt->last_pressure = -1;
+    tt->was_in_edge = 0;
+    tt->was_in_edge_x = 0;
+    tt->was_in_edge_y = 0;
+    tt->preferred_slot = -1;
+    if (!tt->has_mt_tracking_id) {
+        tt->active_fingers = 0;
+        for (int i = 0; i < tt->slot_count; i++) {
+            tt->slot_active[i] = 0;
+            tt->slot_x[i] = -1;
+            tt->slot_y[i] = -1;
+        }
+    }
+}
+
+static void update_button_mask(struct touch_tracker *tt, int bit, int pressed)
+{
+    if (button_cooldown_ms > 0)
+        tt->button_cooldown_until_ms = tt->event_time_ms + button_cooldown_ms;
+    if (pressed)
+        tt->buttons_down_mask |= bit;
+    else
+        tt->buttons_down_mask &= ~bit;
+}
+
+static void process_touch_event(struct touch_tracker *tt, const struct input_event *ev)
+{
+    tt->event_time_ms = event_time_ms(ev);
+    if (ev->type == EV_ABS) {
+        if (ev->code == ABS_MT_SLOT)
+            tt->current_slot = ev->value;
+
+        int slot = tt->current_slot;
+        int slot_valid = slot >= 0 && slot < tt->slot_count;
+
+        if ((ev->code == ABS_MT_POSITION_X || ev->code == ABS_X) && slot_valid) {
+            tt->slot_x[slot] = ev->value;
+            if (tt->tap_start_x < 0)
+                tt->tap_start_x = ev->value;
+            if (tt->preferred_slot < 0 || tt->preferred_slot == slot)
+                tt->preferred_slot = slot;
+            if (tt->preferred_slot == slot && tt->slot_y[slot] >= 0)
+                tt->last_x = ev->value;
+        }
+        if ((ev->code == ABS_MT_POSITION_Y || ev->code == ABS_Y) && slot_valid) {
+            tt->slot_y[slot] = ev->value;
+            if (tt->tap_start_y < 0)
+                tt->tap_start_y = ev->value;
+            if (tt->preferred_slot < 0 || tt->preferred_slot == slot)
+                tt->preferred_slot = slot;
+            if (tt->preferred_slot == slot && tt->slot_x[slot] >= 0)
+                tt->last_y = ev->value;
+        }
+
+        if (ev->code == ABS_MT_PRESSURE || ev->code == ABS_PRESSURE)
+            tt->last_pressure = ev->value;
+
+        if (ev->code == ABS_MT_TRACKING_ID && slot_valid) {
+            if (ev->value == -1) {
+                if (tt->slot_active[slot] && tt->active_fingers > 0)
+                    tt->active_fingers--;
+                tt->slot_active[slot] = 0;
+                tt->slot_x[slot] = -1;
+                tt->slot_y[slot] = -1;
+                if (tt->preferred_slot == slot)
+                    tt->preferred_slot = -1;
+            } else {
+                // Finger touched
+                if (!tt->slot_active[slot])
+                    tt->active_fingers++;
+                tt->slot_active[slot] = 1;
+                tt->preferred_slot = slot;
+            }
+        }
+    } else if (ev->type == EV_KEY) {
+        if (ev->code == BTN_LEFT) {
+            update_button_mask(tt, 1, ev->value != 0);
+            // Single click cancels double-tap mode
+            if (double_tap_hold_mode && ev->value == 1) {
+                tt->double_tap_active = 0;
+                tt->tap_count = 0;
+                tt->last_tap_time_ms = 0;
+            }
+        } else if (ev->code == BTN_RIGHT) {
+            update_button_mask(tt, 2, ev->value != 0);
+        } else if (ev->code == BTN_MIDDLE) {
+            update_button_mask(tt, 4, ev->value != 0);
+        }
+
+        int touch_released = 0;
+        if ((tt->has_btn_touch && ev->code == BTN_TOUCH) ||
+            (!tt->has_btn_touch && tt->has_touch_tool_keys && is_touch_tool_key(ev->code))) {
+            tt->touch_contact = ev->value > 0 ? 1 : 0;
+            touch_released = ev->value == 0;
+            if (ev->value == 1) // Touch started
+                register_touch_start(tt);
+        }
+
+        if (touch_released)
+            register_touch_release(tt);
+    }
+}
+
+static void finish_touch_frame(struct touch_tracker *tt)
+{
+    int active_slot = -1;
+    int preferred = tt->preferred_slot;
+    if (preferred >= 0 && preferred < tt->slot_count && tt->slot_active[preferred] &&
+        tt->slot_x[preferred] >= 0 && tt->slot_y[preferred] >= 0)
+        active_slot = preferred;
+    else {
+        for (int i = 0; i < tt->slot_count; i++) {
+            if (tt->slot_active[i] && tt->slot_x[i] >= 0 && tt->slot_y[i] >= 0) {
+                active_slot = i;
+                break;
+            }
+        }
+    }
+
+    if (active_slot >= 0) {
+        tt->last_x = tt->slot_x[active_slot];
+        tt->last_y = tt->slot_y[active_slot];
+    } else if (tt->has_mt_tracking_id) {
+        tt->last_x = -1;
+        tt->last_y = -1;
+    }
+    EM_PROBE4(frame, active_slot, tt->last_x, tt->last_y, tt->active_fingers);
+    flight_record(FLIGHT_FRAME, active_slot, tt->last_x, tt->last_y, tt->active_fingers);
+}
+
+static int fetch_mt_slot_values(int fd, struct touch_tracker *tt, unsigned int code)
+{
+    size_t size = ((size_t)tt->slot_count + 1) * sizeof(int32_t);
+    tt->mt_sync_buf[0] = (int32_t)code;
+    return ioctl(fd, EVIOCGMTSLOTS(size), tt->mt_sync_buf);
+}
+
+static int test_key_bit(const unsigned long *bits, int code)
+{
+    size_t word_bits = sizeof(unsigned long) * 8;
+    return (bits[(size_t)code / word_bits] >> ((size_t)code % word_bits)) & 1UL;
+}
+
+// After SYN_DROPPED the queued deltas are useless; pull the complete device state in bulk
+// (one EVIOCGMTSLOTS per axis, EVIOCGABS for the current slot, EVIOCGKEY for buttons).
+static int resync_touch_tracker(int fd, struct touch_tracker *tt)
+{
+    unsigned long keys[KEY_CNT / (sizeof(unsigned long) * 8) + 1];
+    memset(keys, 0, sizeof(keys));
+    if (ioctl(fd, EVIOCGKEY(sizeof(keys)), keys) < 0)
+        return -1;
+
+    int was_touching = tt->touch_contact;
+    tt->buttons_down_mask = (test_key_bit(keys, BTN_LEFT) ? 1 : 0) |
+                            (test_key_bit(keys, BTN_RIGHT) ? 2 : 0) |
+                            (test_key_bit(keys, BTN_MIDDLE) ? 4 : 0);
+    if (tt->has_btn_touch)
+        tt->touch_contact = test_key_bit(keys, BTN_TOUCH);
+    else if (tt->has_touch_tool_keys)
+        tt->touch_contact = test_key_bit(keys, BTN_TOOL_FINGER) || test_key_bit(keys, BTN_TOOL_DOUBLETAP) ||
+                            test_key_bit(keys, BTN_TOOL_TRIPLETAP) || test_key_bit(keys, BTN_TOOL_QUADTAP) ||
+                            test_key_bit(keys, BTN_TOOL_QUINTTAP);
+
+    if (tt->has_mt_tracking_id) {
+        if (fetch_mt_slot_values(fd, tt, ABS_MT_TRACKING_ID) < 0)
+            return -1;
+        tt->active_fingers = 0;
+        for (int i = 0; i < tt->slot_count; i++) {
+            tt->slot_active[i] = tt->mt_sync_buf[i + 1] >= 0;
+            if (tt->slot_active[i])
+                tt->active_fingers++;
+        }
+
+        if (fetch_mt_slot_values(fd, tt, ABS_MT_POSITION_X) < 0)
+            return -1;
+        for (int i = 0; i < tt->slot_count; i++)
+            tt->slot_x[i] = tt->slot_active[i] ? tt->mt_sync_buf[i + 1] : -1;
+
+        if (fetch_mt_slot_values(fd, tt, ABS_MT_POSITION_Y) < 0)
+            return -1;
+        for (int i = 0; i < tt->slot_count; i++)
+            tt->slot_y[i] = tt->slot_active[i] ? tt->mt_sync_buf[i + 1] : -1;
+
+        struct input_absinfo slot_info;
+        if (ioctl(fd, EVIOCGABS(ABS_MT_SLOT), &slot_info) == 0)
+            tt->current_slot = slot_info.value;
+
+        int preferred = tt->preferred_slot;
+        if (preferred >= tt->slot_count || (preferred >= 0 && !tt->slot_active[preferred]))
+            tt->preferred_slot = -1;
+    } else if (tt->touch_contact || !tt->has_touch_contact_key) {
+        struct input_absinfo absx;
+        struct input_absinfo absy;
+        if (ioctl(fd, EVIOCGABS(ABS_X), &absx) < 0 || ioctl(fd, EVIOCGABS(ABS_Y), &absy) < 0)
+            return -1;
+        tt->slot_x[0] = absx.value;
+        tt->slot_y[0] = absy.value;
+        tt->last_x = absx.value;
+        tt->last_y = absy.value;
+    }
+
+    if (tt->has_pressure) {
+        struct input_absinfo pressure;
+        if (ioctl(fd, EVIOCGABS(ABS_MT_PRESSURE), &pressure) == 0)
+            tt->last_pressure = pressure.value;
+    }
+
+    if (was_touching && tt->touch_contact == 0)
+        register_touch_release(tt);
+
+    return 0;
+}
+
+static int is_coalescable_event(const struct input_event *ev)
+{
+    return ev->type == EV_ABS &&
+           (ev->code == ABS_MT_POSITION_X || ev->code == ABS_MT_POSITION_Y || ev->code == ABS_X ||
+            ev->code == ABS_Y || ev->code == ABS_MT_PRESSURE || ev->code == ABS_PRESSURE);
+}
 
-    *slot_x = new_slot_x;
-    *slot_y = new_slot_y;
-    *slot_active = new_slot_active;
-    *slot_count = new_slot_count;
+// Key, tracking-id and SYN_DROPPED events end a coalescing run: they reset touch, tap and slot
+// bookkeeping, so values on either side of them are never merged.
+static int is_coalesce_barrier(const struct input_event *ev)
+{
+    return ev->type == EV_KEY || (ev->type == EV_SYN && ev->code == SYN_DROPPED) ||
+           (ev->type == EV_ABS && ev->code == ABS_MT_TRACKING_ID);
+}
 
+// Returns whether (slot, code) is already in the list, adding it if not.
+static int slot_code_seen(struct slot_code *seen, size_t *count, int slot, unsigned int code)
+{
+    for (size_t j = 0; j < *count; j++)
+        if (seen[j].slot == slot && seen[j].code == code)
+            return 1;
+    seen[*count].slot = slot;
+    seen[*count].code = code;
+    (*count)++;
     return 0;
 }
 
+// Catch-up after a stall: when a batch holds several complete frames, a position or pressure
+// value that the same slot overwrites later in the same run is never observed by the
+// classifier, so it is skipped. The first position value of each slot and axis in a run is
+// kept too: after a reset that is the event that claims preferred_slot and tap_start_x/y, so
+// which finger is tracked does not depend on coalescing. Returns the number of stale events.
+static size_t mark_stale_events(struct raw_reader *reader, size_t count, size_t complete, int slot)
+{
+    int event_slot[RAW_EVENT_BATCH];
+    unsigned char first[RAW_EVENT_BATCH];
+    struct slot_code seen[RAW_EVENT_BATCH];
+    size_t seen_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        const struct input_event *ev = &reader->events[i];
+        if (ev->type == EV_ABS && ev->code == ABS_MT_SLOT)
+            slot = ev->value;
+        event_slot[i] = slot;
+        reader->stale[i] = 0;
+        first[i] = 0;
+        if (is_coalesce_barrier(ev))
+            seen_count = 0;
+        else if (is_coalescable_event(ev) && ev->code != ABS_MT_PRESSURE && ev->code != ABS_PRESSURE)
+            first[i] = !slot_code_seen(seen, &seen_count, slot, ev->code);
+    }
+
+    seen_count = 0;
+    size_t stale = 0;
+    for (size_t i = complete; i-- > 0;) {
+        const struct input_event *ev = &reader->events[i];
+        if (is_coalesce_barrier(ev)) {
+            seen_count = 0;
+            continue;
+        }
+        if (!is_coalescable_event(ev))
+            continue;
+
+        if (slot_code_seen(seen, &seen_count, event_slot[i], ev->code) && !first[i]) {
+            reader->stale[i] = 1;
+            stale++;
+        }
+    }
+
+    return stale;
+}
+
+// Raw mode: one read() drains up to RAW_EVENT_BATCH events which are decoded in place,
+// bypassing libevdev's per-event copy and its shadow slot state. Returns -EAGAIN once the
+// kernel queue is empty, like libevdev_next_event().
+static int read_raw_events(int fd, struct raw_reader *reader, struct touch_tracker *tt, int *sync_received)
+{
+    for (;;) {
+        ssize_t n = read(fd, reader->events, sizeof(reader->events));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK ? -EAGAIN : -errno;
+        }
+        if (n == 0)
+            return -ENODEV;
+
+        size_t count = (size_t)n / sizeof(struct input_event);
+        atomic_fetch_add_explicit(&input_stats.events, count, memory_order_relaxed);
+        int coalesce = 0;
+        if (catch_up_mode) {
+            size_t frames = 0;
+            size_t complete = 0;
+            for (size_t i = 0; i < count; i++) {
+                if (reader->events[i].type == EV_SYN && reader->events[i].code == SYN_REPORT) {
+                    frames++;
+                    complete = i + 1;
+                }
+            }
+            if (frames > 1) {
+                reader->coalesced += mark_stale_events(reader, count, complete, tt->current_slot);
+                coalesce = 1;
+            }
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            const struct input_event *ev = &reader->events[i];
+            if (coalesce && reader->stale[i])
+                continue;
+            if (ev->type == EV_SYN && ev->code == SYN_DROPPED) {
+                reader->dropped = 1;
+                continue;
+            }
+
+            if (ev->type == EV_SYN && ev->code == SYN_REPORT) {
+                atomic_fetch_add_explicit(&input_stats.frames, 1, memory_order_relaxed);
+                if (reader->dropped) {
+                    reader->dropped = 0;
+                    if (resync_touch_tracker(fd, tt) < 0)
+                        return -errno;
+                }
+                tt->event_time_ms = event_time_ms(ev);
+                tt->frame_time_ns = event_time_ns(ev);
+                *sync_received = 1;
+                continue;
+            }
+
+            if (!reader->dropped)
+                process_touch_event(tt, ev);
+        }
+
+        // A short read means the kernel buffer is drained; skip the extra EAGAIN syscall.
+        if (count < RAW_EVENT_BATCH)
+            return -EAGAIN;
+    }
+}
+
 static void cleanup_touchpad_resources(struct touchpad_resources *tp)
 {
     if (tp->devnode) {
@@ -628,6 +2020,11 @@ static int create_uinput_device(void)
         close(fd);
         return -1;
     }
+    if (hires_scroll &&
+        (ioctl(fd, UI_SET_RELBIT, REL_WHEEL_HI_RES) < 0 || ioctl(fd, UI_SET_RELBIT, REL_HWHEEL_HI_RES) < 0)) {
+        close(fd);
+        return -1;
+    }
 
     struct uinput_setup uset = {0};
     snprintf(uset.name, UINPUT_MAX_NAME_SIZE, "edge-motion-virtual-mouse");
@@ -656,6 +2053,52 @@ static void free_touchpad_candidates(struct touchpad_candidate *items, size_t co
     free(items);
 }
 
+// sysfs capability bitmaps are space separated hex words, most significant first, each as
+// wide as the kernel's long.
+static void parse_sysfs_bitmap(const char *value, struct sysfs_bitmap *bitmap)
+{
+    size_t max_words = sizeof(bitmap->words) / sizeof(bitmap->words[0]);
+    bitmap->count = 0;
+    const char *p = value;
+    while (p && *p && bitmap->count < max_words) {
+        char *end = NULL;
+        unsigned long word = strtoul(p, &end, 16);
+        if (end == p)
+            break;
+        bitmap->words[bitmap->count++] = word;
+        p = end;
+    }
+}
+
+static int sysfs_bitmap_test(const struct sysfs_bitmap *bitmap, unsigned int bit)
+{
+    size_t word_bits = sizeof(unsigned long) * 8;
+    size_t index = bit / word_bits;
+    if (index >= bitmap->count)
+        return 0;
+    return (bitmap->words[bitmap->count - 1 - index] >> (bit % word_bits)) & 1UL;
+}
+
+static int has_touch_contact_signal(const struct sysfs_bitmap *abs, const struct sysfs_bitmap *key)
+{
+    return sysfs_bitmap_test(abs, ABS_MT_TRACKING_ID) || sysfs_bitmap_test(key, BTN_TOUCH) ||
+           sysfs_bitmap_test(key, BTN_TOOL_FINGER) || sysfs_bitmap_test(key, BTN_TOOL_DOUBLETAP) ||
+           sysfs_bitmap_test(key, BTN_TOOL_TRIPLETAP) || sysfs_bitmap_test(key, BTN_TOOL_QUADTAP) ||
+           sysfs_bitmap_test(key, BTN_TOOL_QUINTTAP);
+}
+
+static int udev_property_int(struct udev_device *dev, const char *key)
+{
+    const char *value = udev_device_get_property_value(dev, key);
+    int parsed = 0;
+    if (!value || parse_int_arg(value, &parsed) < 0 || parsed < 0)
+        return 0;
+    return parsed;
+}
+
+// Candidates are probed from what udev already exports (capability bitmaps of the parent
+// input device, ID_INPUT_* properties) so that listing or ranking them never opens an evdev
+// node, which could wake a runtime-suspended I2C/SMBus touchpad.
 static int enumerate_touchpad_candidates(struct touchpad_candidate **out_items, size_t *out_count)
 {
     struct udev *udev = udev_new();
@@ -682,71 +2125,46 @@ static int enumerate_touchpad_candidates(struct touchpad_candidate **out_items,
             continue;
 
         const char *devnode = udev_device_get_devnode(dev);
-        if (devnode && strstr(devnode, "/event") && !is_ignored_devnode(devnode)) {
-            int fd = open(devnode, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
-            if (fd >= 0) {
-                struct libevdev *evdev = NULL;
-                if (libevdev_new_from_fd(fd, &evdev) == 0) {
-                    const struct input_absinfo *absx =
-                        libevdev_get_abs_info(evdev, ABS_MT_POSITION_X);
-                    if (!absx)
-                        absx = libevdev_get_abs_info(evdev, ABS_X);
-                    const struct input_absinfo *absy =
-                        libevdev_get_abs_info(evdev, ABS_MT_POSITION_Y);
-                    if (!absy)
-                        absy = libevdev_get_abs_info(evdev, ABS_Y);
-
-                    if (absx && absy && absx->maximum >= absx->minimum &&
-                        absy->maximum >= absy->minimum && has_touch_contact_signal(evdev)) {
-                        const char *device_name = libevdev_get_name(evdev) ? libevdev_get_name(evdev)
-                                                                          : "unknown";
-                        char *devnode_copy = strdup(devnode);
-                        char *name_copy = strdup(device_name);
-                        if (devnode_copy && name_copy) {
-                            struct touchpad_candidate *tmp =
-                                realloc(items, (count + 1) * sizeof(*items));
-                            if (tmp) {
-                                items = tmp;
-                                items[count].devnode = devnode_copy;
-                                items[count].name = name_copy;
-                                items[count].integrated =
-                                    udev_device_get_property_value(dev,
-                                                                   "ID_INPUT_TOUCHPAD_INTEGRATED") &&
-                                            strcmp(udev_device_get_property_value(
-                                                       dev, "ID_INPUT_TOUCHPAD_INTEGRATED"),
-                                                   "1") == 0
-                                        ? 1
-                                        : 0;
-                                items[count].min_x = absx->minimum;
-                                items[count].max_x = absx->maximum;
-                                items[count].min_y = absy->minimum;
-                                items[count].max_y = absy->maximum;
-                                long long range_x =
-                                    (long long)absx->maximum - (long long)absx->minimum;
-                                long long range_y =
-                                    (long long)absy->maximum - (long long)absy->minimum;
-                                items[count].area = range_x * range_y;
-                                count++;
-                            } else {
-                                free(devnode_copy);
-                                free(name_copy);
-                                free_touchpad_candidates(items, count);
-                                libevdev_free(evdev);
-                                close(fd);
-                                udev_device_unref(dev);
-                                udev_enumerate_unref(en);
-                                udev_unref(udev);
-                                return -1;
-                            }
-                        } else {
-                            free(devnode_copy);
-                            free(name_copy);
-                        }
-                    }
-                    libevdev_free(evdev);
-                }
-                close(fd);
+        struct udev_device *parent = udev_device_get_parent_with_subsystem_devtype(dev, "input", NULL);
+        if (!devnode || !strstr(devnode, "/event") || is_ignored_devnode(devnode) || !parent) {
+            udev_device_unref(dev);
+            continue;
+        }
+
+        struct sysfs_bitmap abs;
+        struct sysfs_bitmap key;
+        parse_sysfs_bitmap(udev_device_get_sysattr_value(parent, "capabilities/abs"), &abs);
+        parse_sysfs_bitmap(udev_device_get_sysattr_value(parent, "capabilities/key"), &key);
+
+        int has_x = sysfs_bitmap_test(&abs, ABS_MT_POSITION_X) || sysfs_bitmap_test(&abs, ABS_X);
+        int has_y = sysfs_bitmap_test(&abs, ABS_MT_POSITION_Y) || sysfs_bitmap_test(&abs, ABS_Y);
+        if (has_x && has_y && has_touch_contact_signal(&abs, &key)) {
+            const char *device_name = udev_device_get_sysattr_value(parent, "name");
+            char *devnode_copy = strdup(devnode);
+            char *name_copy = strdup(device_name ? device_name : "unknown");
+            struct touchpad_candidate *tmp =
+                devnode_copy && name_copy ? realloc(items, (count + 1) * sizeof(*items)) : NULL;
+            if (!tmp) {
+                free(devnode_copy);
+                free(name_copy);
+                free_touchpad_candidates(items, count);
+                udev_device_unref(dev);
+                udev_enumerate_unref(en);
+                udev_unref(udev);
+                return -1;
             }
+
+            const char *integrated = udev_device_get_property_value(dev, "ID_INPUT_TOUCHPAD_INTEGRATED");
+            items = tmp;
+            items[count].devnode = devnode_copy;
+            items[count].name = name_copy;
+            items[count].integrated = integrated && strcmp(integrated, "1") == 0 ? 1 : 0;
+            // input_id derives the physical size from the axis resolution, which ranks
+            // touchpads the same way the axis area did without an EVIOCGABS round trip.
+            items[count].width_mm = udev_property_int(dev, "ID_INPUT_WIDTH_MM");
+            items[count].height_mm = udev_property_int(dev, "ID_INPUT_HEIGHT_MM");
+            items[count].area = (long long)items[count].width_mm * (long long)items[count].height_mm;
+            count++;
         }
 
         udev_device_unref(dev);
@@ -770,56 +2188,157 @@ static int print_touchpad_devices(void)
     }
 
     for (size_t i = 0; i < count; i++) {
-        printf("%s\t%s\tintegrated=%s\tarea=%lld\trange=[%d..%d]x[%d..%d]\n",
+        printf("%s\t%s\tintegrated=%s\tarea=%lld\tsize=%dx%dmm\n",
                items[i].devnode,
                items[i].name,
                items[i].integrated ? "yes" : "no",
                items[i].area,
-               items[i].min_x,
-               items[i].max_x,
-               items[i].min_y,
-               items[i].max_y);
+               items[i].width_mm,
+               items[i].height_mm);
     }
 
     free_touchpad_candidates(items, count);
     return 0;
 }
 
-static char *find_touchpad_devnode(void)
+static int read_axis_range(int fd, int mt_code, int code)
+{
+    struct input_absinfo info;
+    if (ioctl(fd, EVIOCGABS(mt_code), &info) == 0 && info.maximum > info.minimum)
+        return info.maximum - info.minimum;
+    if (ioctl(fd, EVIOCGABS(code), &info) == 0 && info.maximum > info.minimum)
+        return info.maximum - info.minimum;
+    return 0;
+}
+
+// Axis area in device units, the ranking key used before udev sizes. It needs an open, so it
+// is only read when udev does not know the physical size of every candidate.
+static long long read_axis_area(const char *devnode)
+{
+    int fd = open(devnode, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return 0;
+    long long area = (long long)read_axis_range(fd, ABS_MT_POSITION_X, ABS_X) *
+                     (long long)read_axis_range(fd, ABS_MT_POSITION_Y, ABS_Y);
+    close(fd);
+    return area;
+}
+
+static int touchpad_candidate_better(const struct touchpad_candidate *a, const struct touchpad_candidate *b)
+{
+    if (a->integrated != b->integrated)
+        return a->integrated > b->integrated;
+    return a->area > b->area;
+}
+
+// Candidates best first: integrated before external, then larger before smaller. Physical
+// sizes are only comparable if udev has them for all; otherwise every candidate is ranked by
+// axis area instead of falling back to enumeration order.
+static int rank_touchpad_candidates(struct touchpad_candidate **out_items, size_t *out_count)
 {
     struct touchpad_candidate *items = NULL;
     size_t count = 0;
     if (enumerate_touchpad_candidates(&items, &count) < 0)
-        return NULL;
+        return -1;
+
+    int sized = 1;
+    for (size_t i = 0; i < count; i++)
+        if (items[i].area <= 0)
+            sized = 0;
+    if (!sized && count > 1)
+        for (size_t i = 0; i < count; i++)
+            items[i].area = read_axis_area(items[i].devnode);
 
-    size_t best = 0;
+    // Insertion sort: a handful of entries, and ties keep enumeration order.
     for (size_t i = 1; i < count; i++) {
-        int better_integrated = items[i].integrated > items[best].integrated;
-        int same_integrated = items[i].integrated == items[best].integrated;
-        int better_area = items[i].area > items[best].area;
-        if (better_integrated || (same_integrated && better_area))
-            best = i;
+        struct touchpad_candidate item = items[i];
+        size_t j = i;
+        while (j > 0 && touchpad_candidate_better(&item, &items[j - 1])) {
+            items[j] = items[j - 1];
+            j--;
+        }
+        items[j] = item;
     }
 
-    char *result = items[best].devnode ? strdup(items[best].devnode) : NULL;
-    free_touchpad_candidates(items, count);
-    return result;
+    *out_items = items;
+    *out_count = count;
+    return 0;
 }
 
-static int reopen_touchpad(struct touchpad_resources *tp,
-                           int *min_x, int *max_x, int *min_y, int *max_y)
+static void hotplug_monitor_close(struct hotplug_monitor *hp)
 {
-    cleanup_touchpad_resources(tp);
+    if (hp->monitor)
+        udev_monitor_unref(hp->monitor);
+    if (hp->udev)
+        udev_unref(hp->udev);
+    hp->monitor = NULL;
+    hp->udev = NULL;
+    hp->fd = -1;
+}
 
-    if (forced_devnode) {
-        if (is_ignored_devnode(forced_devnode))
-            return -1;
-        tp->devnode = strdup(forced_devnode);
-        if (!tp->devnode)
-            return -1;
-    } else {
-        tp->devnode = find_touchpad_devnode();
+static int hotplug_monitor_open(struct hotplug_monitor *hp)
+{
+    hp->udev = udev_new();
+    if (!hp->udev)
+        goto fail;
+
+    hp->monitor = udev_monitor_new_from_netlink(hp->udev, "udev");
+    if (!hp->monitor || udev_monitor_filter_add_match_subsystem_devtype(hp->monitor, "input", NULL) < 0 ||
+        udev_monitor_enable_receiving(hp->monitor) < 0)
+        goto fail;
+
+    hp->fd = udev_monitor_get_fd(hp->monitor);
+    if (hp->fd < 0)
+        goto fail;
+
+    return 0;
+
+fail:
+    hotplug_monitor_close(hp);
+    return -1;
+}
+
+// --device is commonly a by-id/by-path symlink, so the device numbers are compared rather
+// than the node names.
+static int is_forced_device(struct udev_device *dev, const char *devnode)
+{
+    struct stat st;
+    if (stat(forced_devnode, &st) == 0 && S_ISCHR(st.st_mode))
+        return st.st_rdev == udev_device_get_devnum(dev);
+
+    char resolved[PATH_MAX];
+    if (realpath(forced_devnode, resolved))
+        return strcmp(devnode, resolved) == 0;
+    return strcmp(devnode, forced_devnode) == 0;
+}
+
+// Drains pending uevents and reports whether one of them added a usable touchpad node.
+static int hotplug_monitor_touchpad_added(struct hotplug_monitor *hp)
+{
+    int added = 0;
+    struct udev_device *dev;
+    while ((dev = udev_monitor_receive_device(hp->monitor)) != NULL) {
+        const char *action = udev_device_get_action(dev);
+        const char *devnode = udev_device_get_devnode(dev);
+        const char *touchpad = udev_device_get_property_value(dev, "ID_INPUT_TOUCHPAD");
+
+        if (action && strcmp(action, "add") == 0 && devnode && strstr(devnode, "/event") &&
+            !is_ignored_devnode(devnode)) {
+            if (forced_devnode)
+                added |= is_forced_device(dev, devnode);
+            else
+                added |= touchpad && strcmp(touchpad, "1") == 0;
+        }
+
+        udev_device_unref(dev);
     }
+
+    return added;
+}
+
+static int open_touchpad_devnode(struct touchpad_resources *tp, const char *devnode)
+{
+    tp->devnode = strdup(devnode);
     if (!tp->devnode)
         return -1;
 
@@ -834,11 +2353,635 @@ static int reopen_touchpad(struct touchpad_resources *tp,
         return -1;
     }
 
-    if (use_grab) {
-        int grc = 0;
-        int attempts = 3;
-        useconds_t delay_us = 10000;
-        while (attempts-- > 0) {
+    return 0;
+}
+
+static int touchpad_axes(struct libevdev *dev, const struct input_absinfo **absx, const struct input_absinfo **absy)
+{
+    *absx = libevdev_get_abs_info(dev, ABS_MT_POSITION_X);
+    if (!*absx)
+        *absx = libevdev_get_abs_info(dev, ABS_X);
+    *absy = libevdev_get_abs_info(dev, ABS_MT_POSITION_Y);
+    if (!*absy)
+        *absy = libevdev_get_abs_info(dev, ABS_Y);
+    return *absx && *absy ? 0 : -1;
+}
+
+// Opens the best candidate that works: a node that cannot be opened (permissions, unplugged
+// in the meantime) or reports no usable axes does not hide the next one in the ranking.
+static int open_ranked_touchpad(struct touchpad_resources *tp)
+{
+    struct touchpad_candidate *items = NULL;
+    size_t count = 0;
+    if (rank_touchpad_candidates(&items, &count) < 0)
+        return -1;
+
+    int rc = -1;
+    for (size_t i = 0; i < count && rc < 0; i++) {
+        if (open_touchpad_devnode(tp, items[i].devnode) < 0) {
+            if (verbose)
+                fprintf(stderr, "Skipping %s: cannot open it\n", items[i].devnode);
+            continue;
+        }
+        const struct input_absinfo *absx;
+        const struct input_absinfo *absy;
+        if (touchpad_axes(tp->dev, &absx, &absy) < 0 || absx->maximum <= absx->minimum ||
+            absy->maximum <= absy->minimum) {
+            if (verbose)
+                fprintf(stderr, "Skipping %s: no usable X/Y axes\n", items[i].devnode);
+            cleanup_touchpad_resources(tp);
+            continue;
+        }
+        rc = 0;
+    }
+
+    free_touchpad_candidates(items, count);
+    return rc;
+}
+
+static const char *get_device_cache_path(void)
+{
+    return device_cache_path ? device_cache_path : DEFAULT_DEVICE_CACHE_PATH;
+}
+
+static int read_touchpad_identity(const struct touchpad_resources *tp, struct touchpad_identity *id)
+{
+    memset(id, 0, sizeof(*id));
+    snprintf(id->devnode, sizeof(id->devnode), "%s", tp->devnode);
+
+    // /sys/dev/char/MAJ:MIN links to the device's sysfs directory; the link text is stable
+    // for a given physical device and costs a single readlink().
+    struct stat st;
+    if (fstat(tp->input_fd, &st) < 0)
+        return -1;
+    char link[64];
+    snprintf(link, sizeof(link), "/sys/dev/char/%u:%u", major(st.st_rdev), minor(st.st_rdev));
+    ssize_t len = readlink(link, id->syspath, sizeof(id->syspath) - 1);
+    if (len < 0)
+        return -1;
+    id->syspath[len] = '\0';
+
+    const char *name = libevdev_get_name(tp->dev);
+    snprintf(id->name, sizeof(id->name), "%s", name ? name : "unknown");
+    id->vendor = libevdev_get_id_vendor(tp->dev);
+    id->product = libevdev_get_id_product(tp->dev);
+
+    const struct input_absinfo *absx = libevdev_get_abs_info(tp->dev, ABS_MT_POSITION_X);
+    if (!absx)
+        absx = libevdev_get_abs_info(tp->dev, ABS_X);
+    const struct input_absinfo *absy = libevdev_get_abs_info(tp->dev, ABS_MT_POSITION_Y);
+    if (!absy)
+        absy = libevdev_get_abs_info(tp->dev, ABS_Y);
+    if (!absx || !absy)
+        return -1;
+
+    id->min_x = absx->minimum;
+    id->max_x = absx->maximum;
+    id->min_y = absy->minimum;
+    id->max_y = absy->maximum;
+    return 0;
+}
+
+static int touchpad_identity_equal(const struct touchpad_identity *a, const struct touchpad_identity *b)
+{
+    return strcmp(a->devnode, b->devnode) == 0 && strcmp(a->syspath, b->syspath) == 0 &&
+           strcmp(a->name, b->name) == 0 && a->vendor == b->vendor && a->product == b->product &&
+           a->min_x == b->min_x && a->max_x == b->max_x && a->min_y == b->min_y && a->max_y == b->max_y;
+}
+
+static int load_touchpad_cache(struct touchpad_identity *id)
+{
+    FILE *fp = fopen(get_device_cache_path(), "r");
+    if (!fp)
+        return -1;
+
+    memset(id, 0, sizeof(*id));
+    int fields = 0;
+    char line[PATH_MAX + 32];
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\n")] = '\0';
+        char *eq = strchr(line, '=');
+        if (!eq)
+            continue;
+        *eq = '\0';
+        const char *key = line;
+        const char *value = eq + 1;
+
+        if (strcmp(key, "devnode") == 0) {
+            snprintf(id->devnode, sizeof(id->devnode), "%s", value);
+            fields++;
+        } else if (strcmp(key, "syspath") == 0) {
+            snprintf(id->syspath, sizeof(id->syspath), "%s", value);
+            fields++;
+        } else if (strcmp(key, "name") == 0) {
+            snprintf(id->name, sizeof(id->name), "%s", value);
+            fields++;
+        } else if (strcmp(key, "id") == 0) {
+            if (sscanf(value, "%x:%x", &id->vendor, &id->product) == 2)
+                fields++;
+        } else if (strcmp(key, "range") == 0) {
+            if (sscanf(value, "%d %d %d %d", &id->min_x, &id->max_x, &id->min_y, &id->max_y) == 4)
+                fields++;
+        }
+    }
+    fclose(fp);
+
+    return fields == 5 && id->devnode[0] == '/' ? 0 : -1;
+}
+
+static void store_touchpad_cache(const struct touchpad_identity *id)
+{
+    const char *path = get_device_cache_path();
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    if (slash && slash != dir) {
+        *slash = '\0';
+        if (mkdir(dir, 0755) < 0 && errno != EEXIST)
+            goto fail;
+    }
+
+    char tmp_path[PATH_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *fp = fopen(tmp_path, "w");
+    if (!fp)
+        goto fail;
+
+    fprintf(fp, "devnode=%s\n", id->devnode);
+    fprintf(fp, "syspath=%s\n", id->syspath);
+    fprintf(fp, "name=%s\n", id->name);
+    fprintf(fp, "id=%04x:%04x\n", id->vendor, id->product);
+    fprintf(fp, "range=%d %d %d %d\n", id->min_x, id->max_x, id->min_y, id->max_y);
+    if (fclose(fp) != 0 || rename(tmp_path, path) < 0) {
+        unlink(tmp_path);
+        goto fail;
+    }
+    return;
+
+fail:
+    if (verbose)
+        fprintf(stderr, "Failed to update device cache %s: %s\n", path, strerror(errno));
+}
+
+// Opens the touchpad remembered from the previous run and keeps it only if its identity
+// still matches, so the full candidate scan runs only when the hardware changed.
+static int open_cached_touchpad(struct touchpad_resources *tp, struct touchpad_identity *cached)
+{
+    if (load_touchpad_cache(cached) < 0 || is_ignored_devnode(cached->devnode))
+        return -1;
+    if (open_touchpad_devnode(tp, cached->devnode) < 0)
+        return -1;
+
+    struct touchpad_identity current;
+    if (read_touchpad_identity(tp, &current) < 0 || !touchpad_identity_equal(&current, cached)) {
+        if (verbose)
+            fprintf(stderr, "Device cache mismatch for %s, rescanning.\n", cached->devnode);
+        cleanup_touchpad_resources(tp);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Normalized coordinate exactly as the classifier has always computed it, deadzone included.
+static double edge_position(int v, int min, int max, int snap)
+{
+    double n = (double)(v - min) / (double)(max - min);
+    if (snap && n > 0.5 - deadzone && n < 0.5 + deadzone)
+        n = 0.5;
+    return n;
+}
+
+// First v in [lo, hi] whose position is >= bound (> bound if strict), or hi + 1. The position
+// never decreases with v, even with the deadzone snap, so a binary search finds the exact
+// coordinate where the floating-point comparison flips.
+static int edge_search(int lo, int hi, int min, int max, int snap, int strict, double bound)
+{
+    int64_t l = lo;
+    int64_t r = (int64_t)hi + 1;
+    while (l < r) {
+        int64_t m = l + (r - l) / 2;
+        double n = edge_position((int)m, min, max, snap);
+        if (strict ? n > bound : n >= bound)
+            r = m;
+        else
+            l = m + 1;
+    }
+    return (int)l;
+}
+
+static void build_edge_axis(struct edge_axis *axis, int min, int max, double low_enter, double high_enter)
+{
+    int range = max - min;
+    double low_leave = low_enter - edge_hysteresis;
+    double high_leave = high_enter - edge_hysteresis;
+
+    axis->lo = min - range;
+    axis->hi = max + range;
+    axis->high_enter = edge_search(axis->lo, axis->hi, min, max, 1, 0, 1.0 - high_enter);
+    axis->high_leave = edge_search(axis->lo, axis->hi, min, max, 1, 0, 1.0 - high_leave);
+    axis->low_enter = edge_search(axis->lo, axis->hi, min, max, 1, 1, low_enter) - 1;
+    axis->low_leave = edge_search(axis->lo, axis->hi, min, max, 1, 1, low_leave) - 1;
+    axis->dead_lo = edge_search(axis->lo, axis->hi, min, max, 0, 1, 0.5 - deadzone);
+    axis->dead_hi = edge_search(axis->lo, axis->hi, min, max, 0, 0, 0.5 + deadzone) - 1;
+
+    // depth = distance past the threshold / edge width; origins are in 1/65536 device units
+    // and the multipliers in 2^32 / edge width, leaving depth in EDGE_DEPTH_ONE after >> 32.
+    axis->low_origin_q16 = llround(((double)min + low_enter * range) * 65536.0);
+    axis->high_origin_q16 = llround(((double)min + (1.0 - high_enter) * range) * 65536.0);
+    axis->low_mult = llround(4294967296.0 / (low_enter * range));
+    axis->high_mult = llround(4294967296.0 / (high_enter * range));
+}
+
+// Returns the edge direction (-1, 0, 1) of one coordinate and its depth in EDGE_DEPTH_ONE units.
+static int classify_edge_axis(const struct edge_axis *axis, int v, int was_in_edge, int *depth)
+{
+    if (v < axis->lo)
+        v = axis->lo;
+    if (v > axis->hi)
+        v = axis->hi;
+
+    int dir = 0;
+    if (was_in_edge) {
+        if (v >= axis->high_leave)
+            dir = 1;
+        else if (v <= axis->low_leave)
+            dir = -1;
+    }
+    if (!dir) {
+        if (v >= axis->high_enter)
+            dir = 1;
+        else if (v <= axis->low_enter)
+            dir = -1;
+    }
+
+    // Inside the deadzone the position snaps to the centre, where depth is always 0.
+    int64_t d = 0;
+    if (v >= axis->dead_lo && v <= axis->dead_hi)
+        d = 0;
+    else if (v >= axis->high_enter)
+        d = ((int64_t)v * 65536 - axis->high_origin_q16) * axis->high_mult;
+    else if (v <= axis->low_enter)
+        d = (axis->low_origin_q16 - (int64_t)v * 65536) * axis->low_mult;
+    d = d > 0 ? d >> 32 : 0;
+    *depth = d > EDGE_DEPTH_ONE ? EDGE_DEPTH_ONE : (int)d;
+    return dir;
+}
+
+// The floating-point classifier the edge table replaced, kept as the reference for --self-test.
+static int edge_reference(int v, int min, int max, double low_enter, double high_enter, int was_in_edge,
+                          double *depth)
+{
+    double n = edge_position(v, min, max, 1);
+    double low_leave = low_enter - edge_hysteresis;
+    double high_leave = high_enter - edge_hysteresis;
+
+    int dir = 0;
+    if (was_in_edge) {
+        if (n >= 1.0 - high_leave)
+            dir = 1;
+        else if (n <= low_leave)
+            dir = -1;
+    }
+    if (!dir) {
+        if (n >= 1.0 - high_enter)
+            dir = 1;
+        else if (n <= low_enter)
+            dir = -1;
+    }
+
+    *depth = 0.0;
+    if (n >= 1.0 - high_enter)
+        *depth = (n - (1.0 - high_enter)) / high_enter;
+    else if (n <= low_enter)
+        *depth = (low_enter - n) / low_enter;
+    if (*depth > 1.0)
+        *depth = 1.0;
+    return dir;
+}
+
+// Compares every coordinate of one axis, from min - range to max + range, against the
+// reference. Depth may be off by the final truncation plus the rounding of the Q16 origin,
+// which is half a 1/65536 device unit, i.e. 0.5 / edge width in depth units.
+static int self_test_axis(int min, int max, double low_enter, double high_enter)
+{
+    struct edge_axis axis;
+    build_edge_axis(&axis, min, max, low_enter, high_enter);
+    double tolerance = 2.0 + 1.0 / (fmin(low_enter, high_enter) * (max - min));
+
+    int button_zone_y = INT_MAX;
+    if (button_zone > 0.0)
+        button_zone_y = edge_search(axis.lo, axis.hi, min, max, 0, 0, 1.0 - button_zone);
+
+    long mismatches = 0;
+    for (int64_t v = axis.lo; v <= axis.hi; v++) {
+        for (int was_in_edge = 0; was_in_edge <= 1; was_in_edge++) {
+            int depth;
+            double ref_depth;
+            int dir = classify_edge_axis(&axis, (int)v, was_in_edge, &depth);
+            int ref_dir = edge_reference((int)v, min, max, low_enter, high_enter, was_in_edge, &ref_depth);
+            if (dir != ref_dir || fabs(depth - ref_depth * EDGE_DEPTH_ONE) > tolerance) {
+                if (mismatches++ < 5)
+                    fprintf(stderr, "  [%d, %d] v=%lld in_edge=%d: dir %d/%d depth %d/%.1f\n", min, max,
+                            (long long)v, was_in_edge, dir, ref_dir, depth, ref_depth * EDGE_DEPTH_ONE);
+            }
+        }
+        if (button_zone > 0.0 && (v >= button_zone_y) != (edge_position((int)v, min, max, 0) >= 1.0 - button_zone)) {
+            if (mismatches++ < 5)
+                fprintf(stderr, "  [%d, %d] v=%lld: button zone starts at %d\n", min, max, (long long)v,
+                        button_zone_y);
+        }
+    }
+    return mismatches ? -1 : 0;
+}
+
+static int self_test_ranges(double low, double high)
+{
+    static const int ranges[][2] = {
+        {0, 1}, {0, 7}, {0, 1000}, {0, 1023}, {0, 4095}, {1266, 5676}, {1094, 4686},
+        {-3000, 3000}, {-32768, 32767}, {0, 65535}, {100000, 123457},
+    };
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+        if (self_test_axis(ranges[i][0], ranges[i][1], low, high) < 0) {
+            fprintf(stderr, "edge table mismatch for range [%d, %d]: thresholds %g/%g hysteresis %g "
+                    "deadzone %g button-zone %g\n", ranges[i][0], ranges[i][1], low, high, edge_hysteresis,
+                    deadzone, button_zone);
+            failed = 1;
+        }
+    }
+    return failed ? -1 : 0;
+}
+
+// Checks the integer edge table against the floating-point classifier over a spread of real
+// and awkward axis ranges: first with the configured options, then over a grid of thresholds,
+// hysteresis, deadzone and button zone, so the deadzone snap and the button-zone search are
+// covered even when the defaults leave them off.
+static int run_self_test(void)
+{
+    static const double lows[] = {0.01, 0.06, 0.3};
+    static const double highs[] = {0.02, 0.13, 0.5};
+    static const double hystereses[] = {0.0, 0.009};
+    static const double deadzones[] = {0.0, 0.07, 0.19};
+    static const double button_zones[] = {0.0, 0.15};
+    double saved_hysteresis = edge_hysteresis;
+    double saved_deadzone = deadzone;
+    double saved_button_zone = button_zone;
+    int failed = 0;
+    int cases = 2;
+
+    if (self_test_ranges(threshold_left, threshold_right) < 0 ||
+        self_test_ranges(threshold_top, threshold_bottom) < 0)
+        failed = 1;
+
+    for (size_t l = 0; l < sizeof(lows) / sizeof(lows[0]); l++)
+        for (size_t h = 0; h < sizeof(highs) / sizeof(highs[0]); h++)
+            for (size_t y = 0; y < sizeof(hystereses) / sizeof(hystereses[0]); y++)
+                for (size_t d = 0; d < sizeof(deadzones) / sizeof(deadzones[0]); d++)
+                    for (size_t b = 0; b < sizeof(button_zones) / sizeof(button_zones[0]); b++) {
+                        // Only combinations the option validation accepts.
+                        if (hystereses[y] >= fmin(lows[l], highs[h]) ||
+                            deadzones[d] + fmax(lows[l], highs[h]) > 0.5)
+                            continue;
+                        edge_hysteresis = hystereses[y];
+                        deadzone = deadzones[d];
+                        button_zone = button_zones[b];
+                        if (self_test_ranges(lows[l], highs[h]) < 0)
+                            failed = 1;
+                        cases++;
+                    }
+
+    edge_hysteresis = saved_hysteresis;
+    deadzone = saved_deadzone;
+    button_zone = saved_button_zone;
+    printf("edge table self-test %s (%d option sets)\n", failed ? "FAILED" : "passed", cases);
+    return failed ? -1 : 0;
+}
+
+static int zone_cell(int64_t v, int min, int64_t span)
+{
+    int64_t cell = (v - min) * ZONE_GRID_SIZE / span;
+    if (cell < 0)
+        return 0;
+    if (cell >= ZONE_GRID_SIZE)
+        return ZONE_GRID_SIZE - 1;
+    return (int)cell;
+}
+
+static int build_zone_grid(int min_x, int max_x, int min_y, int max_y)
+{
+    struct zone_grid *grid = &zone_grid;
+    free(grid->cell_zones);
+    grid->cell_zones = NULL;
+    memset(grid->cell_start, 0, sizeof(grid->cell_start));
+    if (zone_count == 0)
+        return 0;
+
+    grid->min_x = min_x;
+    grid->min_y = min_y;
+    grid->span_x = (int64_t)max_x - min_x + 1;
+    grid->span_y = (int64_t)max_y - min_y + 1;
+
+    struct zone_cell_span *span = calloc(zone_count, sizeof(*span));
+    if (!span)
+        return -1;
+
+    size_t total = 0;
+    for (size_t i = 0; i < zone_count; i++) {
+        struct edge_zone *z = &zones[i];
+        double range_x = (double)(max_x - min_x);
+        double range_y = (double)(max_y - min_y);
+        z->dev_x0 = (int)ceil(min_x + z->x0 * range_x);
+        z->dev_y0 = (int)ceil(min_y + z->y0 * range_y);
+        z->dev_x1 = (int)floor(min_x + z->x1 * range_x);
+        z->dev_y1 = (int)floor(min_y + z->y1 * range_y);
+        // Zones that touch the pad border also cover coordinates reported slightly past it.
+        if (z->x0 <= 0.0)
+            z->dev_x0 = INT_MIN;
+        if (z->y0 <= 0.0)
+            z->dev_y0 = INT_MIN;
+        if (z->x1 >= 1.0)
+            z->dev_x1 = INT_MAX;
+        if (z->y1 >= 1.0)
+            z->dev_y1 = INT_MAX;
+
+        span[i].x0 = zone_cell(z->dev_x0, min_x, grid->span_x);
+        span[i].x1 = zone_cell(z->dev_x1, min_x, grid->span_x);
+        span[i].y0 = zone_cell(z->dev_y0, min_y, grid->span_y);
+        span[i].y1 = zone_cell(z->dev_y1, min_y, grid->span_y);
+        total += (size_t)(span[i].x1 - span[i].x0 + 1) * (size_t)(span[i].y1 - span[i].y0 + 1);
+    }
+
+    grid->cell_zones = malloc(total * sizeof(*grid->cell_zones));
+    if (!grid->cell_zones) {
+        free(span);
+        return -1;
+    }
+
+    // Count per cell, prefix-sum into row starts, then fill in zone order so that the first
+    // containing zone found in a cell is also the highest-priority one.
+    for (size_t i = 0; i < zone_count; i++)
+        for (int cy = span[i].y0; cy <= span[i].y1; cy++)
+            for (int cx = span[i].x0; cx <= span[i].x1; cx++)
+                grid->cell_start[cy * ZONE_GRID_SIZE + cx + 1]++;
+    for (int c = 0; c < ZONE_GRID_SIZE * ZONE_GRID_SIZE; c++)
+        grid->cell_start[c + 1] += grid->cell_start[c];
+
+    int fill[ZONE_GRID_SIZE * ZONE_GRID_SIZE];
+    memcpy(fill, grid->cell_start, sizeof(fill));
+    for (size_t i = 0; i < zone_count; i++)
+        for (int cy = span[i].y0; cy <= span[i].y1; cy++)
+            for (int cx = span[i].x0; cx <= span[i].x1; cx++)
+                grid->cell_zones[fill[cy * ZONE_GRID_SIZE + cx]++] = (int)i;
+
+    free(span);
+    return 0;
+}
+
+static const struct edge_zone *lookup_zone(int x, int y)
+{
+    const struct zone_grid *grid = &zone_grid;
+    if (!grid->cell_zones)
+        return NULL;
+
+    int cell = zone_cell(y, grid->min_y, grid->span_y) * ZONE_GRID_SIZE + zone_cell(x, grid->min_x, grid->span_x);
+    for (int i = grid->cell_start[cell]; i < grid->cell_start[cell + 1]; i++) {
+        const struct edge_zone *z = &zones[grid->cell_zones[i]];
+        if (x >= z->dev_x0 && x <= z->dev_x1 && y >= z->dev_y0 && y <= z->dev_y1)
+            return z;
+    }
+    return NULL;
+}
+
+static double accel_curve_eval(double depth)
+{
+    if (depth <= accel_curve[0].depth)
+        return accel_curve[0].factor;
+    for (size_t i = 1; i < accel_curve_points; i++) {
+        const struct accel_point *a = &accel_curve[i - 1];
+        const struct accel_point *b = &accel_curve[i];
+        if (depth <= b->depth)
+            return a->factor + (b->factor - a->factor) * (depth - a->depth) / (b->depth - a->depth);
+    }
+    return accel_curve[accel_curve_points - 1].factor;
+}
+
+// Built once from the config: --accel-curve when given, else --accel-exponent, so that the
+// per-frame path has no pow() and no float pressure math.
+static void build_speed_luts(void)
+{
+    for (int i = 0; i < SPEED_LUT_SIZE; i++) {
+        double t = (double)i / (double)(SPEED_LUT_SIZE - 1);
+        double factor = t;
+        if (accel_curve_points > 0)
+            factor = accel_curve_eval(t);
+        else if (accel_exponent != 1.0 && t > 0.0)
+            factor = pow(t, accel_exponent);
+        accel_lut[i] = (int32_t)lround(factor * EDGE_DEPTH_ONE);
+        pressure_lut[i] = (int32_t)lround((1.0 + t * pressure_boost) * EDGE_DEPTH_ONE);
+    }
+}
+
+// Linear interpolation between the two LUT entries around depth.
+static int32_t accel_lookup(int depth)
+{
+    int shift = EDGE_DEPTH_SHIFT - SPEED_LUT_BITS;
+    int i = depth >> shift;
+    if (i >= SPEED_LUT_SIZE - 1)
+        return accel_lut[SPEED_LUT_SIZE - 1];
+    int32_t frac = depth & ((1 << shift) - 1);
+    return accel_lut[i] + (((accel_lut[i + 1] - accel_lut[i]) * frac) >> shift);
+}
+
+static void set_mask_bit(unsigned long *bits, unsigned int bit)
+{
+    size_t word_bits = sizeof(unsigned long) * 8;
+    bits[bit / word_bits] |= 1UL << (bit % word_bits);
+}
+
+static int set_event_mask(int fd, unsigned int type, const unsigned long *bits, size_t size)
+{
+    struct input_mask mask = {
+        .type = type,
+        .codes_size = (uint32_t)size,
+        .codes_ptr = (uint64_t)(uintptr_t)bits,
+    };
+    return ioctl(fd, EVIOCSMASK, &mask);
+}
+
+// Lets the kernel drop everything the tracker ignores (touch size, orientation, MSC_TIMESTAMP,
+// pressure unless --pressure-boost is used) before it is queued for this fd. The mask belongs
+// to the open file, so every reopen installs it again. EV_SYN is never filtered, so
+// SYN_REPORT and SYN_DROPPED still arrive; resync reads state with ioctls, unaffected by it.
+static void apply_event_mask(int fd)
+{
+    unsigned long types[EV_CNT / (sizeof(unsigned long) * 8) + 1] = {0};
+    unsigned long abs_codes[ABS_CNT / (sizeof(unsigned long) * 8) + 1] = {0};
+    unsigned long key_codes[KEY_CNT / (sizeof(unsigned long) * 8) + 1] = {0};
+
+    set_mask_bit(types, EV_SYN);
+    set_mask_bit(types, EV_KEY);
+    set_mask_bit(types, EV_ABS);
+
+    set_mask_bit(abs_codes, ABS_X);
+    set_mask_bit(abs_codes, ABS_Y);
+    set_mask_bit(abs_codes, ABS_MT_SLOT);
+    set_mask_bit(abs_codes, ABS_MT_POSITION_X);
+    set_mask_bit(abs_codes, ABS_MT_POSITION_Y);
+    set_mask_bit(abs_codes, ABS_MT_TRACKING_ID);
+    if (pressure_boost > 0.0) {
+        set_mask_bit(abs_codes, ABS_PRESSURE);
+        set_mask_bit(abs_codes, ABS_MT_PRESSURE);
+    }
+
+    set_mask_bit(key_codes, BTN_LEFT);
+    set_mask_bit(key_codes, BTN_RIGHT);
+    set_mask_bit(key_codes, BTN_MIDDLE);
+    set_mask_bit(key_codes, BTN_TOUCH);
+    set_mask_bit(key_codes, BTN_TOOL_FINGER);
+    set_mask_bit(key_codes, BTN_TOOL_DOUBLETAP);
+    set_mask_bit(key_codes, BTN_TOOL_TRIPLETAP);
+    set_mask_bit(key_codes, BTN_TOOL_QUADTAP);
+    set_mask_bit(key_codes, BTN_TOOL_QUINTTAP);
+
+    // Kernels before 4.4 lack EVIOCSMASK; the daemon then just filters in userspace as before.
+    if (set_event_mask(fd, EV_ABS, abs_codes, sizeof(abs_codes)) < 0 ||
+        set_event_mask(fd, EV_KEY, key_codes, sizeof(key_codes)) < 0 ||
+        set_event_mask(fd, EV_SYN, types, sizeof(types)) < 0) {
+        if (verbose)
+            fprintf(stderr, "EVIOCSMASK unavailable: %s\n", strerror(errno));
+    }
+}
+
+static int reopen_touchpad(struct touchpad_resources *tp,
+                           int *min_x, int *max_x, int *min_y, int *max_y)
+{
+    cleanup_touchpad_resources(tp);
+
+    if (forced_devnode) {
+        if (is_ignored_devnode(forced_devnode))
+            return -1;
+        if (open_touchpad_devnode(tp, forced_devnode) < 0)
+            return -1;
+    } else {
+        struct touchpad_identity cached;
+        int cache_hit = device_cache_enabled && open_cached_touchpad(tp, &cached) == 0;
+        if (!cache_hit) {
+            if (open_ranked_touchpad(tp) < 0)
+                return -1;
+
+            struct touchpad_identity current;
+            if (device_cache_enabled && read_touchpad_identity(tp, &current) == 0)
+                store_touchpad_cache(&current);
+        }
+    }
+
+    if (use_grab) {
+        int grc = 0;
+        int attempts = 3;
+        useconds_t delay_us = 10000;
+        while (attempts-- > 0) {
             grc = libevdev_grab(tp->dev, LIBEVDEV_GRAB);
             if (grc == 0)
                 break;
@@ -851,164 +2994,868 @@ static int reopen_touchpad(struct touchpad_resources *tp,
             fprintf(stderr, "Failed to grab touchpad: %s\n", strerror(-grc));
     }
 
-    const struct input_absinfo *absx = libevdev_get_abs_info(tp->dev, ABS_MT_POSITION_X);
-    if (!absx)
-        absx = libevdev_get_abs_info(tp->dev, ABS_X);
-    const struct input_absinfo *absy = libevdev_get_abs_info(tp->dev, ABS_MT_POSITION_Y);
-    if (!absy)
-        absy = libevdev_get_abs_info(tp->dev, ABS_Y);
+    apply_event_mask(tp->input_fd);
+
+    // Also a per-fd setting, so it is renewed on every open.
+    event_clock_monotonic = libevdev_set_clock_id(tp->dev, CLOCK_MONOTONIC) == 0;
+    if (!event_clock_monotonic && verbose)
+        fprintf(stderr, "EVIOCSCLOCKID failed, timing gestures at processing time.\n");
+
+    const struct input_absinfo *absx;
+    const struct input_absinfo *absy;
+    if (touchpad_axes(tp->dev, &absx, &absy) < 0) {
+        cleanup_touchpad_resources(tp);
+        return -1;
+    }
+
+    *min_x = absx->minimum;
+    *max_x = absx->maximum;
+    *min_y = absy->minimum;
+    *max_y = absy->maximum;
+
+    if (*max_x > *min_x && *max_y > *min_y) {
+        build_edge_axis(&edge_table.x, *min_x, *max_x, threshold_left, threshold_right);
+        build_edge_axis(&edge_table.y, *min_y, *max_y, threshold_top, threshold_bottom);
+        edge_table.button_zone_y = INT_MAX;
+        if (button_zone > 0.0)
+            edge_table.button_zone_y = edge_search(edge_table.y.lo, edge_table.y.hi, *min_y, *max_y, 0, 0,
+                                                   1.0 - button_zone);
+        if (build_zone_grid(*min_x, *max_x, *min_y, *max_y) < 0) {
+            cleanup_touchpad_resources(tp);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void read_pressure_range(struct libevdev *dev, int *min_pressure, int *max_pressure)
+{
+    const struct input_absinfo *pressure = libevdev_get_abs_info(dev, ABS_MT_PRESSURE);
+    if (!pressure)
+        pressure = libevdev_get_abs_info(dev, ABS_PRESSURE);
+
+    if (pressure && pressure->maximum > pressure->minimum) {
+        *min_pressure = pressure->minimum;
+        *max_pressure = pressure->maximum;
+    } else {
+        *min_pressure = 0;
+        *max_pressure = 0;
+    }
+}
+
+static void build_emission_plan(int edge_active, int dx, int dy, double speed_factor,
+                                enum em_mode plan_mode, double speed_scale, struct emission_plan *plan)
+{
+    plan->edge_active = edge_active;
+    plan->mode = plan_mode;
+    plan->step_x = 0;
+    plan->step_y = 0;
+    plan->interval_ns = (int64_t)pulse_us * 1000LL;
+
+    double len = sqrt((double)dx * (double)dx + (double)dy * (double)dy);
+    if (!edge_active || len < 1e-9)
+        return;
+
+    // No rounding here: fractions of a unit are accumulated by the emitter instead of being
+    // dropped, so slow and diagonal motion keep their speed and angle.
+    // With --velocity the step is what the velocity covers in one nominal interval; the
+    // emitter rescales it by the time that really passed. The cap then applies to the speed,
+    // not to the step, so a long --pulse-us does not lower the top speed.
+    double gain = (1.0 + speed_factor * (max_speed - 1.0)) * speed_scale;
+    double current_step;
+    if (velocity > 0.0) {
+        double current_velocity = velocity * gain;
+        if (current_velocity > MAX_VELOCITY)
+            current_velocity = MAX_VELOCITY;
+        current_step = current_velocity * (double)plan->interval_ns / 1e9;
+    } else {
+        current_step = pulse_step * gain;
+        if (current_step > 100.0)
+            current_step = 100.0;
+    }
+    double step_x = (double)dx / len * current_step;
+    double step_y = (double)dy / len * current_step;
+
+    if (plan_mode == EM_MODE_SCROLL && !diagonal_scroll) {
+        if (scroll_priority == SCROLL_PRIORITY_HORIZONTAL) {
+            step_y = 0.0;
+        } else if (scroll_priority == SCROLL_PRIORITY_VERTICAL) {
+            step_x = 0.0;
+        } else if (fabs(step_x) >= fabs(step_y)) {
+            step_y = 0.0;
+        } else {
+            step_x = 0.0;
+        }
+    }
+
+    if (adaptive_rate) {
+        // Keep the step at the smallest useful size and spend the speed on the pulse rate
+        // instead: slow edge motion then costs a few large-enough pulses rather than a wakeup
+        // every interval. The velocity (step per nominal interval) is unchanged.
+        double min_step = 1.0;
+        if (plan_mode == EM_MODE_SCROLL && hires_scroll)
+            min_step = 1.0 / 8.0;
+        double magnitude = sqrt(step_x * step_x + step_y * step_y);
+        double nominal_ns = (double)plan->interval_ns;
+        double interval_ns = magnitude > 0.0 ? nominal_ns * min_step / magnitude : nominal_ns;
+        double min_ns = (double)(min_pulse_us > 0 ? min_pulse_us : pulse_us) * 1000.0;
+        double max_ns = (double)max_pulse_us * 1000.0;
+        if (interval_ns < min_ns)
+            interval_ns = min_ns;
+        if (interval_ns > max_ns)
+            interval_ns = max_ns;
+        step_x *= interval_ns / nominal_ns;
+        step_y *= interval_ns / nominal_ns;
+        plan->interval_ns = (int64_t)interval_ns;
+    }
+
+    // The plan carries the step as an int in 1/STEP_ONE units; a long interval must not wrap
+    // it, so an oversized step is scaled down as a whole to keep its direction.
+    double largest = fmax(fabs(step_x), fabs(step_y));
+    if (largest > MAX_PLAN_STEP) {
+        step_x *= MAX_PLAN_STEP / largest;
+        step_y *= MAX_PLAN_STEP / largest;
+    }
+    plan->step_x = (int)lround(step_x * STEP_ONE);
+    plan->step_y = (int)lround(step_y * STEP_ONE);
+}
+
+static void read_emission_plan(struct emission_plan *plan)
+{
+    uint32_t begin;
+    uint32_t end;
+    do {
+        begin = atomic_load_explicit(&state.seq, memory_order_acquire);
+        plan->edge_active = atomic_load_explicit(&state.edge_active, memory_order_relaxed);
+        plan->mode = atomic_load_explicit(&state.mode, memory_order_relaxed);
+        plan->step_x = atomic_load_explicit(&state.step_x, memory_order_relaxed);
+        plan->step_y = atomic_load_explicit(&state.step_y, memory_order_relaxed);
+        plan->interval_ns = atomic_load_explicit(&state.interval_ns, memory_order_relaxed);
+        plan->published_ns = atomic_load_explicit(&state.published_ns, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        end = atomic_load_explicit(&state.seq, memory_order_relaxed);
+    } while ((begin & 1U) || begin != end);
+}
+
+static void write_emission_plan(const struct emission_plan *plan)
+{
+    uint32_t seq = atomic_load_explicit(&state.seq, memory_order_relaxed);
+    atomic_store_explicit(&state.seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&state.edge_active, plan->edge_active, memory_order_relaxed);
+    atomic_store_explicit(&state.mode, plan->mode, memory_order_relaxed);
+    atomic_store_explicit(&state.step_x, plan->step_x, memory_order_relaxed);
+    atomic_store_explicit(&state.step_y, plan->step_y, memory_order_relaxed);
+    atomic_store_explicit(&state.interval_ns, plan->interval_ns, memory_order_relaxed);
+    atomic_store_explicit(&state.published_ns, plan->published_ns, memory_order_relaxed);
+    atomic_store_explicit(&state.seq, seq + 2, memory_order_release);
+}
+
+static void futex_wait_until(_Atomic uint32_t *word, uint32_t expected, const struct timespec *deadline)
+{
+    // FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC deadline; NULL waits forever.
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG, expected, deadline,
+            NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+static void wake_pulser(void)
+{
+    atomic_fetch_add_explicit(&state.wake, 1, memory_order_release);
+    syscall(SYS_futex, (uint32_t *)&state.wake, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT_MAX, NULL, NULL, 0);
+}
+
+static int publish_edge_state(int edge_active, int dx, int dy, double speed_factor, enum em_mode plan_mode,
+                              double speed_scale)
+{
+    int changed = (state.last_edge_active != edge_active || state.last_dir_x != dx ||
+                   state.last_dir_y != dy || fabs(state.last_speed_factor - speed_factor) > 0.0001 ||
+                   state.last_mode != (int)plan_mode || state.last_speed_scale != speed_scale);
+    if (!changed)
+        return 0;
+
+    int activated = edge_active && !state.last_edge_active;
+    // speed_factor goes out in thousandths; USDT arguments are integers for most consumers.
+    EM_PROBE4(edge_state, edge_active, dx, dy, (int)(speed_factor * 1000.0));
+    flight_record(FLIGHT_PUBLISH, edge_active, dx, dy, (int32_t)(speed_factor * 1000.0));
+    if (activated)
+        atomic_fetch_add_explicit(&input_stats.activations, 1, memory_order_relaxed);
+    state.last_edge_active = edge_active;
+    state.last_dir_x = dx;
+    state.last_dir_y = dy;
+    state.last_speed_factor = speed_factor;
+    state.last_mode = (int)plan_mode;
+    state.last_speed_scale = speed_scale;
+
+    struct emission_plan plan;
+    build_emission_plan(edge_active, dx, dy, speed_factor, plan_mode, speed_scale, &plan);
+    plan.published_ns = latency_stats ? monotonic_now_ns() : 0;
+    write_emission_plan(&plan);
+
+    // Only an idle pulser needs a syscall; direction and speed changes are picked up on the next tick.
+    if (activated && !event_loop_mode)
+        wake_pulser();
+    return 1;
+}
+
+static void deactivate_edge_motion(void)
+{
+    publish_edge_state(0, 0, 0, 0.0, mode, 1.0);
+}
+
+static void destroy_uinput_device(int *ufd)
+{
+    if (*ufd < 0)
+        return;
+
+    ioctl(*ufd, UI_DEV_DESTROY);
+    close(*ufd);
+    *ufd = -1;
+}
+
+static void emitter_reset(struct emitter *em)
+{
+    em->last_pulse_ns = 0;
+    em->step_acc_x = 0;
+    em->step_acc_y = 0;
+    em->wheel_acc_x = 0;
+    em->wheel_acc_y = 0;
+}
+
+// Adds a fixed-point step to the accumulator and takes out the whole units; the remainder
+// keeps its sign, so reversing direction does not leak a unit.
+static int take_whole_units(int64_t *acc, int64_t step)
+{
+    *acc += step;
+    int64_t whole = *acc / STEP_ONE;
+    *acc -= whole * STEP_ONE;
+    return (int)whole;
+}
+
+// Hi-res units always go out; the legacy code follows only once a whole detent accumulated,
+// which is what hi-res aware mice do for clients that still read REL_WHEEL.
+static void frame_add_wheel(struct emit_frame *frame, unsigned int hires_code, unsigned int code,
+                            int value, int *acc)
+{
+    if (!value)
+        return;
+
+    frame_add(frame, EV_REL, hires_code, value);
+    *acc += value;
+    int detents = *acc / WHEEL_HI_RES_PER_DETENT;
+    if (detents) {
+        frame_add(frame, EV_REL, code, detents);
+        *acc -= detents * WHEEL_HI_RES_PER_DETENT;
+    }
+}
+
+static int emit_edge_pulse(struct emitter *em, const struct emission_plan *plan)
+{
+    if (em->ufd < 0) {
+        if (monotonic_now_ns() < em->retry_at_ns)
+            return 0;
+        em->ufd = create_uinput_device();
+        if (em->ufd < 0)
+            return -1;
+    }
+
+    if (plan->published_ns && plan->published_ns != em->seen_published_ns) {
+        latency_record(LAT_PUBLISH_TO_EMITTER, monotonic_now_ns() - plan->published_ns);
+        em->seen_published_ns = plan->published_ns;
+    }
+
+    int64_t step_x = plan->step_x;
+    int64_t step_y = plan->step_y;
+    if (velocity > 0.0) {
+        // Distance follows elapsed monotonic time, so a late wakeup moves further instead of
+        // slowing down. A long stall is capped so it cannot turn into a jump.
+        int64_t now_ns = monotonic_now_ns();
+        int64_t dt_ns = em->last_pulse_ns ? now_ns - em->last_pulse_ns : plan->interval_ns;
+        if (dt_ns > plan->interval_ns * VELOCITY_MAX_DT_PULSES)
+            dt_ns = plan->interval_ns * VELOCITY_MAX_DT_PULSES;
+        em->last_pulse_ns = now_ns;
+        step_x = step_x * dt_ns / plan->interval_ns;
+        step_y = step_y * dt_ns / plan->interval_ns;
+    }
+
+    // Remainders are in the previous mode's units; a zone switching modes starts afresh.
+    if (plan->mode != em->mode) {
+        emitter_reset(em);
+        em->mode = plan->mode;
+    }
+
+    struct emit_frame frame = {.count = 0};
+    if (plan->mode == EM_MODE_MOTION) {
+        int x = take_whole_units(&em->step_acc_x, step_x);
+        int y = take_whole_units(&em->step_acc_y, step_y);
+        if (x)
+            frame_add(&frame, EV_REL, REL_X, x);
+        if (y)
+            frame_add(&frame, EV_REL, REL_Y, y);
+    } else if (hires_scroll) {
+        int x = take_whole_units(&em->step_acc_x, step_x * WHEEL_HI_RES_PER_DETENT);
+        int y = take_whole_units(&em->step_acc_y, step_y * WHEEL_HI_RES_PER_DETENT);
+        frame_add_wheel(&frame, REL_HWHEEL_HI_RES, REL_HWHEEL, x, &em->wheel_acc_x);
+        frame_add_wheel(&frame, REL_WHEEL_HI_RES, REL_WHEEL, natural_scroll ? y : -y, &em->wheel_acc_y);
+    } else {
+        int x = take_whole_units(&em->step_acc_x, step_x);
+        int y = take_whole_units(&em->step_acc_y, step_y);
+        if (x)
+            frame_add(&frame, EV_REL, REL_HWHEEL, x);
+        if (y)
+            frame_add(&frame, EV_REL, REL_WHEEL, natural_scroll ? y : -y);
+    }
+    // A pulse that only advanced the remainder has nothing to report.
+    if (frame.count == 0)
+        return 0;
+    frame_add(&frame, EV_SYN, SYN_REPORT, 0);
+
+    if (emit_frame(em->ufd, &frame) < 0)
+        return -1;
+    atomic_fetch_add_explicit(&emit_stats.pulses, 1, memory_order_relaxed);
+    // The first two events; a pulse carries at most four plus SYN_REPORT.
+    EM_PROBE5(pulse, (int)frame.count - 1, frame.events[0].code, frame.events[0].value, frame.events[1].code,
+              frame.events[1].value);
+    // Two events per entry, without the closing SYN_REPORT.
+    size_t events = frame.count - 1;
+    for (size_t i = 0; i < events; i += 2) {
+        if (i + 1 < events)
+            flight_record(FLIGHT_EMIT, FLIGHT_EVENT_ID(frame.events[i]), frame.events[i].value,
+                          FLIGHT_EVENT_ID(frame.events[i + 1]), frame.events[i + 1].value);
+        else
+            flight_record(FLIGHT_EMIT, FLIGHT_EVENT_ID(frame.events[i]), frame.events[i].value, FLIGHT_EVENT_NONE, 0);
+    }
+    return 0;
+}
+
+// Drops the device after a failed pulse; emit_edge_pulse() recreates it once UINPUT_RETRY_MS
+// has passed, so motion resumes while the finger is still on the edge.
+static void emitter_pulse_failed(struct emitter *em)
+{
+    int err = errno;
+    // emit_frame() gives up on a full queue when asked to stop; that is not a device error.
+    if (!running || atomic_load_explicit(&pulser_stop, memory_order_relaxed))
+        return;
+    if (em->ufd >= 0) {
+        flight_record(FLIGHT_EMIT_ERROR, err, 0, 0, 0);
+        flight_dump("uinput error");
+        if (verbose)
+            fprintf(stderr, "uinput write failed, retrying in %d ms.\n", UINPUT_RETRY_MS);
+        destroy_uinput_device(&em->ufd);
+    }
+    em->retry_at_ns = monotonic_now_ns() + UINPUT_RETRY_MS * 1000000LL;
+}
+
+static void *pulser_thread(void *arg)
+{
+    struct emitter em = {.ufd = (int)(intptr_t)arg, .mode = mode};
+
+    // Termination signals belong to the main loop's poll().
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGUSR1);
+    sigaddset(&mask, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    // Absolute deadline of the next pulse; 0 means the next pulse is due right away.
+    int64_t next_ns = 0;
+
+    while (running && !atomic_load_explicit(&pulser_stop, memory_order_relaxed)) {
+        // Load the futex word before the plan so an activation in between cannot be missed.
+        uint32_t wake = atomic_load_explicit(&state.wake, memory_order_acquire);
+        struct emission_plan plan;
+        read_emission_plan(&plan);
+
+        if (!plan.edge_active) {
+            emitter_reset(&em);
+            next_ns = 0;
+            futex_wait_until(&state.wake, wake, NULL);
+            atomic_fetch_add_explicit(&emit_stats.wakeups, 1, memory_order_relaxed);
+            continue;
+        }
+
+        int64_t now_ns = monotonic_now_ns();
+        if (next_ns && now_ns < next_ns) {
+            struct timespec deadline;
+            ns_to_timespec(next_ns, &deadline);
+            futex_wait_until(&state.wake, wake, &deadline);
+            atomic_fetch_add_explicit(&emit_stats.wakeups, 1, memory_order_relaxed);
+            // A re-activation while we slept restarts the cadence with an immediate pulse.
+            if (atomic_load_explicit(&state.wake, memory_order_acquire) != wake)
+                next_ns = 0;
+            continue;
+        }
+
+        int64_t tick_ns = next_ns ? next_ns : now_ns;
+        if (latency_stats && next_ns)
+            latency_record(LAT_PULSE_JITTER, now_ns - next_ns);
+        if ((plan.step_x || plan.step_y) && emit_edge_pulse(&em, &plan) < 0)
+            emitter_pulse_failed(&em);
+
+        // The next deadline follows from the previous one, not from "now", so the time spent in
+        // write() does not accumulate as drift. Deadlines already missed are dropped and counted
+        // rather than replayed as a burst.
+        next_ns = tick_ns + plan.interval_ns;
+        now_ns = monotonic_now_ns();
+        if (next_ns <= now_ns) {
+            int64_t missed = (now_ns - next_ns) / plan.interval_ns + 1;
+            atomic_fetch_add_explicit(&emit_stats.skipped_ticks, (uint64_t)missed, memory_order_relaxed);
+            next_ns += missed * plan.interval_ns;
+        }
+    }
+
+    destroy_uinput_device(&em.ufd);
+
+    return NULL;
+}
+
+// Replaces a pulser thread the resource guard caught spinning: it exits together with its
+// uinput device, and a fresh one takes over from the next activation.
+static int restart_pulser(pthread_t *thr, struct resource_guard_state *guard)
+{
+    // The metrics thread must stop sampling the old thread's CPU clock before it goes away.
+    atomic_store_explicit(&thread_clocks.has_pulser, 0, memory_order_release);
+    deactivate_edge_motion();
+    atomic_store_explicit(&pulser_stop, 1, memory_order_relaxed);
+    wake_pulser();
+    // The pulser may be the thread that misbehaves (e.g. stuck retrying a full uinput queue),
+    // so the guard does not wait on it forever; the caller then stops the daemon instead.
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += PULSER_JOIN_TIMEOUT_MS * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+    if (pthread_timedjoin_np(*thr, NULL, &deadline) != 0) {
+        fprintf(stderr, "Pulser thread did not stop within %d ms.\n", PULSER_JOIN_TIMEOUT_MS);
+        return -1;
+    }
+    atomic_store_explicit(&pulser_stop, 0, memory_order_relaxed);
+
+    int ufd = create_uinput_device();
+    if (ufd < 0)
+        return -1;
+    if (pthread_create(thr, NULL, pulser_thread, (void *)(intptr_t)ufd) != 0) {
+        destroy_uinput_device(&ufd);
+        return -1;
+    }
+
+    clockid_t clock;
+    if (pthread_getcpuclockid(*thr, &clock) == 0) {
+        atomic_store_explicit(&thread_clocks.pulser, clock, memory_order_relaxed);
+        atomic_store_explicit(&thread_clocks.has_pulser, 1, memory_order_release);
+    }
+    guard->last_thread_cpu[GUARD_TARGET_PULSER] = 0.0;
+    atomic_fetch_add_explicit(&guard_stats.emitter_restarts, 1, memory_order_relaxed);
+    return 0;
+}
+
+static void event_loop_close(struct event_loop *loop)
+{
+    if (loop->guard_fd >= 0)
+        close(loop->guard_fd);
+    if (loop->pulse_fd >= 0)
+        close(loop->pulse_fd);
+    if (loop->signal_fd >= 0)
+        close(loop->signal_fd);
+    if (loop->epoll_fd >= 0)
+        close(loop->epoll_fd);
+
+    loop->guard_fd = -1;
+    loop->pulse_fd = -1;
+    loop->signal_fd = -1;
+    loop->epoll_fd = -1;
+    loop->input_fd = -1;
+    loop->pulse_armed = 0;
+    loop->pulse_interval_ns = 0;
+}
+
+static int event_loop_watch(struct event_loop *loop, int fd)
+{
+    struct epoll_event ev = {.events = EPOLLIN, .data.fd = fd};
+    return epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static int event_loop_init(struct event_loop *loop)
+{
+    loop->epoll_fd = -1;
+    loop->signal_fd = -1;
+    loop->pulse_fd = -1;
+    loop->guard_fd = -1;
+    loop->input_fd = -1;
+    loop->pulse_armed = 0;
+    loop->pulse_interval_ns = 0;
+
+    // SIGINT/SIGTERM (and SIGUSR1/SIGUSR2 with --latency-stats/--flight-recorder) are consumed
+    // through signalfd, so they must not reach the handlers.
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    if (latency_stats)
+        sigaddset(&mask, SIGUSR1);
+    if (flight_recorder)
+        sigaddset(&mask, SIGUSR2);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) < 0)
+        return -1;
 
-    if (!absx || !absy) {
-        cleanup_touchpad_resources(tp);
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    loop->signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    loop->pulse_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (loop->epoll_fd < 0 || loop->signal_fd < 0 || loop->pulse_fd < 0 ||
+        event_loop_watch(loop, loop->signal_fd) < 0 || event_loop_watch(loop, loop->pulse_fd) < 0) {
+        event_loop_close(loop);
         return -1;
     }
 
-    *min_x = absx->minimum;
-    *max_x = absx->maximum;
-    *min_y = absy->minimum;
-    *max_y = absy->maximum;
+    if (resource_guard_enabled) {
+        struct itimerspec its = {
+            .it_interval = {.tv_sec = RESOURCE_CHECK_INTERVAL_MS / 1000,
+                            .tv_nsec = (RESOURCE_CHECK_INTERVAL_MS % 1000) * 1000000L},
+            .it_value = {.tv_sec = RESOURCE_CHECK_INTERVAL_MS / 1000,
+                         .tv_nsec = (RESOURCE_CHECK_INTERVAL_MS % 1000) * 1000000L},
+        };
+        loop->guard_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (loop->guard_fd < 0 || timerfd_settime(loop->guard_fd, 0, &its, NULL) < 0 ||
+            event_loop_watch(loop, loop->guard_fd) < 0) {
+            event_loop_close(loop);
+            return -1;
+        }
+    }
 
     return 0;
 }
 
-static void read_pressure_range(struct libevdev *dev, int *min_pressure, int *max_pressure)
+static int event_loop_set_input(struct event_loop *loop, int fd)
 {
-    const struct input_absinfo *pressure = libevdev_get_abs_info(dev, ABS_MT_PRESSURE);
-    if (!pressure)
-        pressure = libevdev_get_abs_info(dev, ABS_PRESSURE);
+    if (loop->input_fd >= 0)
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, loop->input_fd, NULL);
+    loop->input_fd = -1;
 
-    if (pressure && pressure->maximum > pressure->minimum) {
-        *min_pressure = pressure->minimum;
-        *max_pressure = pressure->maximum;
-    } else {
-        *min_pressure = 0;
-        *max_pressure = 0;
-    }
+    if (fd < 0)
+        return 0;
+    if (event_loop_watch(loop, fd) < 0)
+        return -1;
+    loop->input_fd = fd;
+    return 0;
 }
 
-static void deactivate_edge_motion(void)
+static void event_loop_arm_pulse(struct event_loop *loop, int enable, int64_t interval_ns)
 {
-    pthread_mutex_lock(&state.lock);
-    state.edge_active = 0;
-    state.dir_x = 0;
-    state.dir_y = 0;
-    state.speed_factor = 0.0;
-    pthread_cond_broadcast(&state.cond);
-    pthread_mutex_unlock(&state.lock);
+    struct itimerspec its = {0};
+    if (enable) {
+        its.it_interval.tv_sec = (time_t)(interval_ns / 1000000000LL);
+        its.it_interval.tv_nsec = (long)(interval_ns % 1000000000LL);
+        its.it_value = its.it_interval;
+    }
+
+    timerfd_settime(loop->pulse_fd, 0, &its, NULL);
+    loop->pulse_armed = enable;
+    loop->pulse_interval_ns = enable ? interval_ns : 0;
+    if (latency_stats && enable)
+        loop->pulse_deadline_ns = monotonic_now_ns() + interval_ns;
 }
 
-static void get_timeout_timespec(struct timespec *ts, int ms)
+// Changes the period of an armed pulse timer without restarting the current period, so a
+// stream of small speed changes cannot keep pushing the next pulse out.
+static void event_loop_retime_pulse(struct event_loop *loop, int64_t interval_ns)
 {
-    if (ms < 0)
-        ms = 0;
+    struct itimerspec cur;
+    if (timerfd_gettime(loop->pulse_fd, &cur) < 0) {
+        event_loop_arm_pulse(loop, 1, interval_ns);
+        return;
+    }
 
-    clock_gettime(CLOCK_MONOTONIC, ts);
-    int64_t sec_add = ms / 1000;
-    int64_t msec_add = ms % 1000;
-    int64_t nsec = (int64_t)ts->tv_nsec + msec_add * 1000000LL;
-    ts->tv_sec += (time_t)sec_add + (time_t)(nsec / 1000000000LL);
-    ts->tv_nsec = (long)(nsec % 1000000000LL);
+    int64_t remaining_ns = cur.it_value.tv_sec * 1000000000LL + cur.it_value.tv_nsec;
+    int64_t next_ns = interval_ns - (loop->pulse_interval_ns - remaining_ns);
+    if (next_ns < 1)
+        next_ns = 1;
+
+    struct itimerspec its;
+    ns_to_timespec(interval_ns, &its.it_interval);
+    ns_to_timespec(next_ns, &its.it_value);
+    timerfd_settime(loop->pulse_fd, 0, &its, NULL);
+    loop->pulse_interval_ns = interval_ns;
+    if (latency_stats)
+        loop->pulse_deadline_ns = monotonic_now_ns() + next_ns;
 }
 
-static void *pulser_thread(void *arg)
+static void event_loop_pulse(struct event_loop *loop, struct emitter *em)
 {
-    int ufd = (int)(intptr_t)arg;
+    struct emission_plan plan;
+    read_emission_plan(&plan);
+    if (!plan.edge_active) {
+        event_loop_arm_pulse(loop, 0, 0);
+        return;
+    }
 
-    pthread_mutex_lock(&state.lock);
-    while (running) {
-        while (!state.edge_active && running)
-            pthread_cond_wait(&state.cond, &state.lock);
+    if ((plan.step_x || plan.step_y) && emit_edge_pulse(em, &plan) < 0)
+        emitter_pulse_failed(em);
+}
 
-        if (!running)
-            break;
+// Waits like poll(): pfds entries registered with the epoll set get their revents filled in,
+// while the timer and signal fds are serviced internally.
+static int event_loop_wait(struct event_loop *loop, struct emitter *em, int timeout_ms, struct pollfd *pfds,
+                           int nfds, struct resource_guard_state *guard)
+{
+    for (int i = 0; i < nfds; i++)
+        pfds[i].revents = 0;
+
+    // Activation emits the first pulse right away, like the pulser thread does on wakeup.
+    struct emission_plan plan;
+    read_emission_plan(&plan);
+    if (plan.edge_active && !loop->pulse_armed) {
+        event_loop_arm_pulse(loop, 1, plan.interval_ns);
+        emitter_reset(em);
+        event_loop_pulse(loop, em);
+    } else if (!plan.edge_active && loop->pulse_armed) {
+        event_loop_arm_pulse(loop, 0, 0);
+    } else if (plan.edge_active && plan.interval_ns != loop->pulse_interval_ns) {
+        event_loop_retime_pulse(loop, plan.interval_ns);
+    }
 
-        bool edge_active = state.edge_active;
-        int dx = state.dir_x;
-        int dy = state.dir_y;
-        double speed_factor = state.speed_factor;
-        pthread_mutex_unlock(&state.lock);
+    struct epoll_event events[5];
+    int n = epoll_wait(loop->epoll_fd, events, 5, timeout_ms);
+    if (n < 0)
+        return -1;
 
-        int err = 0;
-        if (edge_active && (dx || dy)) {
-            if (ufd < 0)
-                ufd = create_uinput_device();
-            if (ufd < 0) {
-                err = -1;
-                goto relock;
+    int ready = 0;
+    for (int i = 0; i < n; i++) {
+        int fd = events[i].data.fd;
+        if (fd == loop->signal_fd) {
+            struct signalfd_siginfo si;
+            while (read(fd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+                if (si.ssi_signo == SIGUSR1)
+                    latency_dump_requested = 1;
+                else if (si.ssi_signo == SIGUSR2)
+                    flight_dump_requested = 1;
+                else
+                    running = 0;
             }
-
-            double len = sqrt((double)dx * (double)dx + (double)dy * (double)dy);
-            if (len < 1e-9)
-                goto relock;
-            int current_step =
-                (int)lround(pulse_step * (1.0 + speed_factor * (max_speed - 1.0)));
-            if (current_step < 1)
-                current_step = 1;
-            if (current_step > 100)
-                current_step = 100;
-            int step_x = (int)lround((double)dx / len * (double)current_step);
-            int step_y = (int)lround((double)dy / len * (double)current_step);
-
-            if (mode == EM_MODE_MOTION) {
-                if (step_x)
-                    err |= emit_rel(ufd, REL_X, step_x);
-                if (step_y)
-                    err |= emit_rel(ufd, REL_Y, step_y);
-            } else {
-                if (!diagonal_scroll) {
-                    if (scroll_priority == SCROLL_PRIORITY_HORIZONTAL) {
-                        step_y = 0;
-                    } else if (scroll_priority == SCROLL_PRIORITY_VERTICAL) {
-                        step_x = 0;
-                    } else if (abs(step_x) >= abs(step_y)) {
-                        step_y = 0;
-                    } else {
-                        step_x = 0;
-                    }
+        } else if (fd == loop->pulse_fd) {
+            // The periodic timerfd keeps absolute deadlines; a late read reports several
+            // expirations, which are counted as skipped instead of emitted back to back.
+            uint64_t expirations = 0;
+            if (read(fd, &expirations, sizeof(expirations)) == (ssize_t)sizeof(expirations)) {
+                atomic_fetch_add_explicit(&emit_stats.wakeups, 1, memory_order_relaxed);
+                if (expirations > 1)
+                    atomic_fetch_add_explicit(&emit_stats.skipped_ticks, expirations - 1,
+                                              memory_order_relaxed);
+                if (latency_stats) {
+                    latency_record(LAT_PULSE_JITTER, monotonic_now_ns() - loop->pulse_deadline_ns);
+                    loop->pulse_deadline_ns += (int64_t)expirations * loop->pulse_interval_ns;
                 }
-
-                if (step_x)
-                    err |= emit_rel(ufd, REL_HWHEEL, step_x);
-                if (step_y)
-                    err |= emit_rel(ufd, REL_WHEEL, natural_scroll ? step_y : -step_y);
+                event_loop_pulse(loop, em);
+            }
+        } else if (fd == loop->guard_fd) {
+            uint64_t expirations = 0;
+            if (read(fd, &expirations, sizeof(expirations)) == (ssize_t)sizeof(expirations)) {
+                struct timespec now;
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                if (sample_resource_usage(guard, &now) == GUARD_STOP)
+                    running = 0;
+            }
+        } else {
+            for (int j = 0; j < nfds; j++) {
+                if (pfds[j].fd != fd)
+                    continue;
+                // EPOLLIN/EPOLLERR/EPOLLHUP share their bit values with the poll() flags.
+                pfds[j].revents = (short)events[i].events;
+                ready++;
             }
-            err |= emit_syn(ufd);
         }
+    }
+
+    return ready;
+}
+
+static void metrics_printf(struct metrics_buf *buf, const char *fmt, ...)
+{
+    if (buf->len >= sizeof(buf->data))
+        return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf->data + buf->len, sizeof(buf->data) - buf->len, fmt, ap);
+    va_end(ap);
+    if (n > 0)
+        buf->len += (size_t)n;
+    if (buf->len > sizeof(buf->data))
+        buf->len = sizeof(buf->data);
+}
 
-relock:
-        pthread_mutex_lock(&state.lock);
-        if (!running)
+static void metrics_header(struct metrics_buf *buf, const char *name, const char *type, const char *help)
+{
+    metrics_printf(buf, "# HELP edge_motion_%s %s\n# TYPE edge_motion_%s %s\n", name, help, name, type);
+}
+
+static void metrics_counter(struct metrics_buf *buf, const char *name, const char *help, _Atomic uint64_t *value)
+{
+    metrics_header(buf, name, "counter", help);
+    metrics_printf(buf, "edge_motion_%s %llu\n", name,
+                   (unsigned long long)atomic_load_explicit(value, memory_order_relaxed));
+}
+
+// Prometheus text exposition format, built once per scrape.
+static void metrics_render(struct metrics_buf *buf)
+{
+    metrics_counter(buf, "events_read_total", "Input events read from the touchpad.", &input_stats.events);
+    metrics_counter(buf, "frames_total", "Touch frames (SYN_REPORT) read.", &input_stats.frames);
+    metrics_counter(buf, "activations_total", "Edge motion activations.", &input_stats.activations);
+    metrics_counter(buf, "pulses_total", "Pulses written to uinput.", &emit_stats.pulses);
+    metrics_counter(buf, "uinput_events_total", "Events written to uinput.", &emit_stats.events);
+    metrics_counter(buf, "uinput_writes_total", "write() calls on the uinput device.", &emit_stats.write_calls);
+    metrics_counter(buf, "uinput_write_errors_total", "Failed uinput writes.", &emit_stats.write_errors);
+    metrics_counter(buf, "uinput_eagain_retries_total", "uinput writes retried after EAGAIN.",
+                    &emit_stats.eagain_retries);
+    metrics_counter(buf, "skipped_ticks_total", "Pulse deadlines missed and skipped.", &emit_stats.skipped_ticks);
+    metrics_counter(buf, "reconnects_total", "Touchpad reconnects.", &input_stats.reconnects);
+
+    metrics_header(buf, "wakeups_total", "counter", "Thread wakeups.");
+    metrics_printf(buf, "edge_motion_wakeups_total{thread=\"main\"} %llu\n",
+                   (unsigned long long)atomic_load_explicit(&input_stats.wakeups, memory_order_relaxed));
+    metrics_printf(buf, "edge_motion_wakeups_total{thread=\"emitter\"} %llu\n",
+                   (unsigned long long)atomic_load_explicit(&emit_stats.wakeups, memory_order_relaxed));
+
+    metrics_header(buf, "thread_cpu_seconds_total", "counter", "CPU time per thread.");
+    metrics_printf(buf, "edge_motion_thread_cpu_seconds_total{thread=\"main\"} %.6f\n",
+                   thread_cpu_seconds(thread_clocks.main));
+    // A pulser joined right after the flag was read makes clock_gettime() fail; skip it then.
+    double pulser_cpu = atomic_load_explicit(&thread_clocks.has_pulser, memory_order_acquire)
+                            ? thread_cpu_seconds(atomic_load_explicit(&thread_clocks.pulser, memory_order_relaxed))
+                            : -1.0;
+    if (pulser_cpu >= 0.0)
+        metrics_printf(buf, "edge_motion_thread_cpu_seconds_total{thread=\"pulser\"} %.6f\n", pulser_cpu);
+
+    if (resource_guard_enabled) {
+        metrics_header(buf, "guard_thread_cpu_percent", "gauge", "Per-thread CPU at the last resource guard sample.");
+        for (int i = GUARD_TARGET_MAIN; i <= GUARD_TARGET_PULSER; i++)
+            metrics_printf(buf, "edge_motion_guard_thread_cpu_percent{thread=\"%s\"} %.2f\n", guard_target_name(i),
+                           (double)atomic_load_explicit(&guard_stats.thread_cpu_x100[i], memory_order_relaxed) /
+                               100.0);
+        metrics_header(buf, "guard_violations_total", "counter", "Resource limit violations by thread.");
+        for (int i = 0; i < GUARD_TARGET_COUNT; i++)
+            metrics_printf(buf, "edge_motion_guard_violations_total{thread=\"%s\"} %llu\n", guard_target_name(i),
+                           (unsigned long long)atomic_load_explicit(&guard_stats.violations[i],
+                                                                    memory_order_relaxed));
+        metrics_counter(buf, "emitter_restarts_total", "Pulser threads restarted by the resource guard.",
+                        &guard_stats.emitter_restarts);
+    }
+
+    metrics_header(buf, "resident_memory_bytes", "gauge", "Resident set size.");
+    metrics_printf(buf, "edge_motion_resident_memory_bytes %lld\n", (long long)read_rss_kb() * 1024LL);
+
+    metrics_header(buf, "edge_active", "gauge", "1 while edge motion is active.");
+    metrics_printf(buf, "edge_motion_edge_active %d\n",
+                   atomic_load_explicit(&state.edge_active, memory_order_relaxed));
+}
+
+// Every connection gets the current metrics and is closed; there is no request to parse, so
+// "socat - UNIX-CONNECT:<path>" is a complete client.
+static void *metrics_thread(void *arg)
+{
+    struct metrics_server *server = arg;
+
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    struct pollfd pfd[2] = {
+        {.fd = server->listen_fd, .events = POLLIN},
+        {.fd = server->stop_fd, .events = POLLIN},
+    };
+    while (poll(pfd, 2, -1) >= 0 || errno == EINTR) {
+        if (pfd[1].revents)
             break;
+        if (!(pfd[0].revents & POLLIN))
+            continue;
 
-        if (err < 0) {
-            if (verbose)
-                fprintf(stderr, "uinput write failed, disabling edge motion until recovery.\n");
-            if (ufd >= 0) {
-                ioctl(ufd, UI_DEV_DESTROY);
-                close(ufd);
-                ufd = -1;
-            }
-            state.edge_active = 0;
-            state.dir_x = 0;
-            state.dir_y = 0;
-            state.speed_factor = 0.0;
-            pthread_cond_broadcast(&state.cond);
-        }
+        int client = accept4(server->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client < 0)
+            continue;
+
+        // A client that stops reading must not stall the thread for long.
+        struct timeval timeout = {.tv_sec = 1, .tv_usec = 0};
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
 
-        if (running && state.edge_active) {
-            struct timespec ts;
-            get_timeout_timespec(&ts, pulse_ms);
-            pthread_cond_timedwait(&state.cond, &state.lock, &ts);
+        struct metrics_buf buf = {.len = 0};
+        metrics_render(&buf);
+        size_t written = 0;
+        while (written < buf.len) {
+            ssize_t n = send(client, buf.data + written, buf.len - written, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            written += (size_t)n;
         }
+        close(client);
     }
-    pthread_mutex_unlock(&state.lock);
 
-    if (ufd >= 0) {
-        ioctl(ufd, UI_DEV_DESTROY);
-        close(ufd);
+    return NULL;
+}
+
+static int metrics_server_start(struct metrics_server *server, const char *path)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+
+    // A socket left behind by an earlier instance is replaced, but only once nobody answers
+    // on it; a running instance keeps its socket and any other file is not touched.
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (probe < 0)
+            return -1;
+        int rc = connect(probe, (struct sockaddr *)&addr, sizeof(addr));
+        int err = errno;
+        close(probe);
+        if (rc == 0) {
+            errno = EADDRINUSE;
+            return -1;
+        }
+        if (err == ECONNREFUSED)
+            unlink(path);
     }
 
-    return NULL;
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    server->stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (server->listen_fd < 0 || server->stop_fd < 0 ||
+        bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+        return -1;
+    server->bound = 1;
+    // bind() applies the umask; connecting needs write permission on the socket file.
+    if (chmod(path, (mode_t)metrics_socket_mode) < 0 || listen(server->listen_fd, 4) < 0)
+        return -1;
+
+    if (pthread_create(&server->thread, NULL, metrics_thread, server) != 0)
+        return -1;
+    server->thread_started = 1;
+    return 0;
+}
+
+static void metrics_server_stop(struct metrics_server *server, const char *path)
+{
+    if (server->thread_started) {
+        uint64_t one = 1;
+        if (write(server->stop_fd, &one, sizeof(one)) == (ssize_t)sizeof(one))
+            pthread_join(server->thread, NULL);
+        server->thread_started = 0;
+    }
+    if (server->listen_fd >= 0)
+        close(server->listen_fd);
+    if (server->bound)
+        unlink(path);
+    if (server->stop_fd >= 0)
+        close(server->stop_fd);
+    server->listen_fd = -1;
+    server->stop_fd = -1;
+    server->bound = 0;
 }
 
 static void print_usage(const char *prog)
@@ -1022,19 +3869,31 @@ static void print_usage(const char *prog)
     printf("  --threshold-top <0.01-0.5>    Top edge threshold override\n");
     printf("  --threshold-bottom <0.01-0.5> Bottom edge threshold override\n");
     printf("  --hysteresis <0.0-0.2>   Edge hysteresis (default %.3f)\n", DEFAULT_EDGE_HYSTERESIS);
+    printf("  --button-zone <0.0-0.4>  Bottom strip (click area) where activation is disabled (default 0)\n");
+    printf("  --button-cooldown-ms <ms>  No activation for this long after a button change (default 0)\n");
     printf("  --hold-ms <ms>           Hold delay before activation (default %d)\n", DEFAULT_HOLD_MS);
     printf("  --pulse-ms <ms>          Pulse interval (default %d)\n", DEFAULT_PULSE_MS);
+    printf("  --pulse-us <us>          Pulse interval in microseconds (e.g. 6944 for 144 Hz)\n");
     printf("  --pulse-step <n>         Base movement step (default %.1f)\n", DEFAULT_PULSE_STEP);
+    printf("  --velocity <n>           Base speed in units (or detents) per second, scaled by\n");
+    printf("                           elapsed time; replaces --pulse-step (default off)\n");
+    printf("  --adaptive-rate          Vary the pulse interval with speed instead of the step size\n");
+    printf("  --min-pulse-us <us>      Shortest adaptive interval (default and upper bound: the pulse interval)\n");
+    printf("  --max-pulse-us <us>      Longest adaptive interval (default %d)\n", DEFAULT_MAX_PULSE_US);
     printf("  --max-speed <n>          Max speed multiplier (default %.1f)\n", DEFAULT_MAX_SPEED);
     printf("  --mode <motion|scroll>   Cursor motion or wheel scrolling\n");
     printf("  --natural-scroll         Natural scroll direction\n");
     printf("  --reverse-scroll         Alias for --natural-scroll\n");
+    printf("  --no-hires-scroll        Only whole wheel detents (no REL_WHEEL_HI_RES)\n");
     printf("  --diagonal-scroll        Allow diagonal scrolling\n");
     printf("  --two-finger-scroll      Require two fingers in scroll mode\n");
     printf("  --deadzone <0.0-0.49>    Central non-activation zone\n");
     printf("  --scroll-axis-priority <dominant|horizontal|vertical>\n");
     printf("                           Scroll axis preference without diagonal mode\n");
     printf("  --accel-exponent <n>     Non-linear edge depth acceleration (default 1.0)\n");
+    printf("  --accel-curve <d:f,...>  Piecewise-linear depth->speed curve, overrides --accel-exponent\n");
+    printf("  --zone <x0,y0,x1,y1,dir[,mode][,speed]>  Extra activation zone (0..1 coordinates;\n");
+    printf("                           dir: left/right/up/down/up-left/.../exclude); repeatable\n");
     printf("  --pressure-boost <0-2>   Extra speed from touch pressure (default 0)\n");
     printf("  --grab / --no-grab       Exclusive grab (can disable normal touchpad input) / shared mode\n");
     printf("  --device </dev/input/eventX>  Force touchpad device\n");
@@ -1049,7 +3908,23 @@ static void print_usage(const char *prog)
     printf("  --double-tap-hold        Double-tap and hold finger for edge-scrolling\n");
     printf("  --double-tap-window-min <ms> Min time between taps (default 250)\n");
     printf("  --double-tap-window-max <ms> Max time between taps (default 450)\n");
+    printf("  --event-loop             Single-threaded epoll/timerfd loop instead of the pulser thread\n");
+    printf("  --raw-reader             Batched raw evdev reads instead of libevdev_next_event()\n");
+    printf("  --catch-up               After a stall apply only the newest queued positions\n");
+    printf("                           (implies --raw-reader)\n");
+    printf("  --latency-stats          Record input-to-output latency histograms; printed on\n");
+    printf("                           SIGUSR1 and at exit\n");
+    printf("  --metrics-socket <path>  Serve Prometheus text metrics on a Unix socket\n");
+    printf("  --metrics-socket-mode <octal>  Permissions of the metrics socket (default %03o)\n",
+           DEFAULT_METRICS_SOCKET_MODE);
+    printf("  --flight-recorder <path> Keep the last %d frames/publishes/emits in memory and write\n",
+           FLIGHT_RECORD_SIZE);
+    printf("                           them to <path> on SIGUSR2, uinput errors and guard trips\n");
+    printf("  --decode-flight-record <file>  Print a flight record dump and exit\n");
+    printf("  --device-cache <path>    Remember the selected touchpad (default %s)\n", DEFAULT_DEVICE_CACHE_PATH);
+    printf("  --no-device-cache        Always rescan touchpads on start/reconnect\n");
     printf("  --list-devices           Show available touchpads and exit\n");
+    printf("  --self-test              Check the edge table against the float classifier and exit\n");
     printf("  --version                Show version and exit\n");
     printf("  --verbose                Verbose logging\n");
     printf("  --help                   Show this help\n");
@@ -1060,8 +3935,12 @@ enum {
     OPT_THRESHOLD_RIGHT,
     OPT_THRESHOLD_TOP,
     OPT_THRESHOLD_BOTTOM,
+    OPT_BUTTON_ZONE,
+    OPT_BUTTON_COOLDOWN_MS,
     OPT_SCROLL_AXIS_PRIORITY,
     OPT_ACCEL_EXPONENT,
+    OPT_ACCEL_CURVE,
+    OPT_ZONE,
     OPT_PRESSURE_BOOST,
     OPT_IGNORE,
     OPT_DAEMON,
@@ -1074,6 +3953,24 @@ enum {
     OPT_DOUBLE_TAP_HOLD,
     OPT_DOUBLE_TAP_WINDOW_MIN,
     OPT_DOUBLE_TAP_WINDOW_MAX,
+    OPT_EVENT_LOOP,
+    OPT_RAW_READER,
+    OPT_CATCH_UP,
+    OPT_LATENCY_STATS,
+    OPT_METRICS_SOCKET,
+    OPT_METRICS_SOCKET_MODE,
+    OPT_FLIGHT_RECORDER,
+    OPT_DECODE_FLIGHT_RECORD,
+    OPT_SELF_TEST,
+    OPT_DEVICE_CACHE,
+    OPT_NO_DEVICE_CACHE,
+    OPT_HIRES_SCROLL,
+    OPT_NO_HIRES_SCROLL,
+    OPT_PULSE_US,
+    OPT_VELOCITY,
+    OPT_ADAPTIVE_RATE,
+    OPT_MIN_PULSE_US,
+    OPT_MAX_PULSE_US,
 };
 
 int main(int argc, char **argv)
@@ -1085,19 +3982,30 @@ int main(int argc, char **argv)
         {"threshold-right", required_argument, NULL, OPT_THRESHOLD_RIGHT},
         {"threshold-top", required_argument, NULL, OPT_THRESHOLD_TOP},
         {"threshold-bottom", required_argument, NULL, OPT_THRESHOLD_BOTTOM},
+        {"button-zone", required_argument, NULL, OPT_BUTTON_ZONE},
+        {"button-cooldown-ms", required_argument, NULL, OPT_BUTTON_COOLDOWN_MS},
         {"hysteresis", required_argument, NULL, 'y'},
         {"hold-ms", required_argument, NULL, 'H'},
         {"pulse-ms", required_argument, NULL, 'p'},
+        {"pulse-us", required_argument, NULL, OPT_PULSE_US},
         {"pulse-step", required_argument, NULL, 's'},
+        {"velocity", required_argument, NULL, OPT_VELOCITY},
+        {"adaptive-rate", no_argument, NULL, OPT_ADAPTIVE_RATE},
+        {"min-pulse-us", required_argument, NULL, OPT_MIN_PULSE_US},
+        {"max-pulse-us", required_argument, NULL, OPT_MAX_PULSE_US},
         {"max-speed", required_argument, NULL, 'm'},
         {"mode", required_argument, NULL, 'M'},
         {"natural-scroll", no_argument, NULL, 'n'},
+        {"hires-scroll", no_argument, NULL, OPT_HIRES_SCROLL},
+        {"no-hires-scroll", no_argument, NULL, OPT_NO_HIRES_SCROLL},
         {"reverse-scroll", no_argument, NULL, 'r'},
         {"diagonal-scroll", no_argument, NULL, 'D'},
         {"two-finger-scroll", no_argument, NULL, '2'},
         {"deadzone", required_argument, NULL, 'z'},
         {"scroll-axis-priority", required_argument, NULL, OPT_SCROLL_AXIS_PRIORITY},
         {"accel-exponent", required_argument, NULL, OPT_ACCEL_EXPONENT},
+        {"accel-curve", required_argument, NULL, OPT_ACCEL_CURVE},
+        {"zone", required_argument, NULL, OPT_ZONE},
         {"pressure-boost", required_argument, NULL, OPT_PRESSURE_BOOST},
         {"grab", no_argument, NULL, 'g'},
         {"no-grab", no_argument, NULL, 'G'},
@@ -1114,7 +4022,18 @@ int main(int argc, char **argv)
         {"double-tap-window", required_argument, NULL, OPT_DOUBLE_TAP_WINDOW_MAX},
         {"double-tap-window-min", required_argument, NULL, OPT_DOUBLE_TAP_WINDOW_MIN},
         {"double-tap-window-max", required_argument, NULL, OPT_DOUBLE_TAP_WINDOW_MAX},
+        {"event-loop", no_argument, NULL, OPT_EVENT_LOOP},
+        {"raw-reader", no_argument, NULL, OPT_RAW_READER},
+        {"catch-up", no_argument, NULL, OPT_CATCH_UP},
+        {"latency-stats", no_argument, NULL, OPT_LATENCY_STATS},
+        {"metrics-socket", required_argument, NULL, OPT_METRICS_SOCKET},
+        {"metrics-socket-mode", required_argument, NULL, OPT_METRICS_SOCKET_MODE},
+        {"flight-recorder", required_argument, NULL, OPT_FLIGHT_RECORDER},
+        {"decode-flight-record", required_argument, NULL, OPT_DECODE_FLIGHT_RECORD},
+        {"device-cache", required_argument, NULL, OPT_DEVICE_CACHE},
+        {"no-device-cache", no_argument, NULL, OPT_NO_DEVICE_CACHE},
         {"list-devices", no_argument, NULL, 'l'},
+        {"self-test", no_argument, NULL, OPT_SELF_TEST},
         {"version", no_argument, NULL, 'V'},
         {"verbose", no_argument, NULL, 'v'},
         {0, 0, 0, 0},
@@ -1163,6 +4082,18 @@ int main(int argc, char **argv)
                 return 2;
             }
             break;
+        case OPT_BUTTON_ZONE:
+            if (parse_double_arg(optarg, &button_zone) < 0) {
+                fprintf(stderr, "Invalid button-zone: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case OPT_BUTTON_COOLDOWN_MS:
+            if (parse_int_arg(optarg, &button_cooldown_ms) < 0) {
+                fprintf(stderr, "Invalid button-cooldown-ms: %s\n", optarg);
+                return 2;
+            }
+            break;
         case 'y':
             if (parse_double_arg(optarg, &edge_hysteresis) < 0) {
                 fprintf(stderr, "Invalid hysteresis: %s\n", optarg);
@@ -1176,17 +4107,44 @@ int main(int argc, char **argv)
             }
             break;
         case 'p':
-            if (parse_int_arg(optarg, &pulse_ms) < 0) {
+            if (parse_pulse_ms_arg(optarg) < 0) {
                 fprintf(stderr, "Invalid pulse-ms: %s\n", optarg);
                 return 2;
             }
             break;
+        case OPT_PULSE_US:
+            if (parse_int_arg(optarg, &pulse_us) < 0) {
+                fprintf(stderr, "Invalid pulse-us: %s\n", optarg);
+                return 2;
+            }
+            break;
         case 's':
             if (parse_double_arg(optarg, &pulse_step) < 0) {
                 fprintf(stderr, "Invalid pulse-step: %s\n", optarg);
                 return 2;
             }
             break;
+        case OPT_VELOCITY:
+            if (parse_double_arg(optarg, &velocity) < 0) {
+                fprintf(stderr, "Invalid velocity: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case OPT_ADAPTIVE_RATE:
+            adaptive_rate = 1;
+            break;
+        case OPT_MIN_PULSE_US:
+            if (parse_int_arg(optarg, &min_pulse_us) < 0) {
+                fprintf(stderr, "Invalid min-pulse-us: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case OPT_MAX_PULSE_US:
+            if (parse_int_arg(optarg, &max_pulse_us) < 0) {
+                fprintf(stderr, "Invalid max-pulse-us: %s\n", optarg);
+                return 2;
+            }
+            break;
         case 'm':
             if (parse_double_arg(optarg, &max_speed) < 0) {
                 fprintf(stderr, "Invalid max-speed: %s\n", optarg);
@@ -1221,6 +4179,18 @@ int main(int argc, char **argv)
                 return 2;
             }
             break;
+        case OPT_ZONE:
+            if (add_zone(optarg) < 0) {
+                fprintf(stderr, "Invalid zone: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case OPT_ACCEL_CURVE:
+            if (parse_accel_curve(optarg) < 0) {
+                fprintf(stderr, "Invalid accel-curve: %s\n", optarg);
+                return 2;
+            }
+            break;
         case OPT_ACCEL_EXPONENT:
             if (parse_double_arg(optarg, &accel_exponent) < 0) {
                 fprintf(stderr, "Invalid accel-exponent: %s\n", optarg);
@@ -1297,9 +4267,61 @@ int main(int argc, char **argv)
                 return 2;
             }
             break;
+        case OPT_HIRES_SCROLL:
+            hires_scroll = 1;
+            break;
+        case OPT_NO_HIRES_SCROLL:
+            hires_scroll = 0;
+            break;
+        case OPT_EVENT_LOOP:
+            event_loop_mode = 1;
+            break;
+        case OPT_RAW_READER:
+            raw_reader_mode = 1;
+            break;
+        case OPT_CATCH_UP:
+            catch_up_mode = 1;
+            break;
+        case OPT_LATENCY_STATS:
+            latency_stats = 1;
+            break;
+        case OPT_FLIGHT_RECORDER:
+            if (set_flight_record_path(optarg) < 0) {
+                fprintf(stderr, "Invalid flight-recorder: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case OPT_DECODE_FLIGHT_RECORD:
+            decode_flight_path = optarg;
+            break;
+        case OPT_METRICS_SOCKET:
+            if (set_metrics_socket_path(optarg) < 0) {
+                fprintf(stderr, "Invalid metrics-socket: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case OPT_METRICS_SOCKET_MODE:
+            if (set_metrics_socket_mode(optarg) < 0) {
+                fprintf(stderr, "Invalid metrics-socket-mode: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case OPT_DEVICE_CACHE:
+            if (set_device_cache_path(optarg) < 0) {
+                fprintf(stderr, "Invalid device-cache: %s\n", optarg);
+                return 2;
+            }
+            device_cache_enabled = 1;
+            break;
+        case OPT_NO_DEVICE_CACHE:
+            device_cache_enabled = 0;
+            break;
         case 'l':
             list_devices = 1;
             break;
+        case OPT_SELF_TEST:
+            self_test = 1;
+            break;
         case 'V':
             printf("edge-motion %s\n", EDGE_MOTION_VERSION);
             return 0;
@@ -1314,6 +4336,8 @@ int main(int argc, char **argv)
 
     if (list_devices)
         return print_touchpad_devices() == 0 ? 0 : 1;
+    if (decode_flight_path)
+        return decode_flight_record(decode_flight_path) == 0 ? 0 : 1;
 
     if (threshold_left < 0.0)
         threshold_left = edge_threshold;
@@ -1324,17 +4348,27 @@ int main(int argc, char **argv)
     if (threshold_bottom < 0.0)
         threshold_bottom = edge_threshold;
 
+    if (catch_up_mode)
+        raw_reader_mode = 1;
+
     if (edge_threshold < 0.01 || edge_threshold > 0.5 || edge_hysteresis < 0.0 || hold_ms < 0 ||
-        pulse_ms <= 0 || pulse_step <= 0 || pulse_step > 500.0 || max_speed < 1.0 || deadzone < 0.0 || deadzone >= 0.5 ||
+        pulse_us < MIN_PULSE_US || pulse_us > MAX_PULSE_US || pulse_step <= 0 || pulse_step > 500.0 ||
+        velocity < 0.0 || velocity > 100000.0 ||
+        (min_pulse_us != 0 && (min_pulse_us < MIN_PULSE_US || min_pulse_us > pulse_us ||
+                               min_pulse_us > max_pulse_us)) ||
+        max_pulse_us < MIN_PULSE_US || max_pulse_us > MAX_PULSE_US || max_speed < 1.0 || deadzone < 0.0 || deadzone >= 0.5 ||
         threshold_left < 0.01 || threshold_left > 0.5 || threshold_right < 0.01 ||
         threshold_right > 0.5 || threshold_top < 0.01 || threshold_top > 0.5 ||
-        threshold_bottom < 0.01 || threshold_bottom > 0.5 || accel_exponent < 0.0 ||
+        threshold_bottom < 0.01 || threshold_bottom > 0.5 || button_zone < 0.0 || button_zone > 0.4 ||
+        button_cooldown_ms < 0 || button_cooldown_ms > 5000 || accel_exponent < 0.0 ||
         pressure_boost < 0.0 || pressure_boost > 2.0 || max_rss_mb < 0 || max_cpu_percent < 0.0 ||
         resource_grace_checks < 1) {
         fprintf(stderr, "Invalid arguments. See --help.\n");
         return 2;
     }
 
+    build_speed_luts();
+
     double max_threshold = fmax(fmax(threshold_left, threshold_right), fmax(threshold_top, threshold_bottom));
     if (edge_hysteresis >= max_threshold) {
         fprintf(stderr, "hysteresis must be lower than every active threshold\n");
@@ -1346,10 +4380,25 @@ int main(int argc, char **argv)
                 "deadzone + threshold(side) must not exceed 0.5 for left/right/top/bottom\n");
         return 2;
     }
+    if (self_test)
+        return run_self_test() == 0 ? 0 : 1;
 
     struct sigaction sa = {.sa_handler = handle_signal, .sa_flags = 0};
     sigaction(SIGINT, &sa, NULL);
     sigaction(SIGTERM, &sa, NULL);
+    if (latency_stats) {
+        struct sigaction dump_sa = {.sa_handler = handle_latency_dump_signal, .sa_flags = 0};
+        sigaction(SIGUSR1, &dump_sa, NULL);
+    }
+    if (flight_record_path) {
+        flight_recorder = calloc(1, sizeof(*flight_recorder));
+        if (!flight_recorder) {
+            fprintf(stderr, "Failed to allocate the flight recorder.\n");
+            return 1;
+        }
+        struct sigaction flight_sa = {.sa_handler = handle_flight_dump_signal, .sa_flags = 0};
+        sigaction(SIGUSR2, &flight_sa, NULL);
+    }
 
     if (daemon_mode && daemon(0, 0) < 0) {
         perror("daemon");
@@ -1364,545 +4413,440 @@ int main(int argc, char **argv)
 
     int min_x = 0, max_x = 0;
     int min_y = 0, max_y = 0;
-    int *slot_x = NULL;
-    int *slot_y = NULL;
-    unsigned char *slot_active = NULL;
+    struct touch_tracker tt = {0};
+    static struct raw_reader raw_reader;
 
     if (reopen_touchpad(&tp, &min_x, &max_x, &min_y, &max_y) < 0) {
         fprintf(stderr, "Touchpad not found.\n");
         return 1;
     }
 
-    int cond_initialized = 0;
+    struct event_loop loop = {
+        .epoll_fd = -1,
+        .signal_fd = -1,
+        .pulse_fd = -1,
+        .guard_fd = -1,
+        .input_fd = -1,
+        .pulse_armed = 0,
+        .pulse_interval_ns = 0,
+    };
+    struct hotplug_monitor hotplug = {.udev = NULL, .monitor = NULL, .fd = -1};
+    pthread_t thr;
+    int thread_started = 0;
+    struct metrics_server metrics = {.listen_fd = -1, .stop_fd = -1};
+
+    statm_fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    long page_size = sysconf(_SC_PAGESIZE);
+    statm_page_kb = page_size > 0 ? page_size / 1024 : -1;
+    if (pthread_getcpuclockid(pthread_self(), &thread_clocks.main) != 0)
+        thread_clocks.main = CLOCK_THREAD_CPUTIME_ID;
 
-    int ufd = create_uinput_device();
-    if (ufd < 0) {
+    struct emitter emitter = {.ufd = create_uinput_device(), .mode = mode};
+    if (emitter.ufd < 0) {
         fprintf(stderr, "Failed to create uinput (requires root/cap_sys_admin).\n");
         goto cleanup;
     }
 
-    pthread_condattr_t cattr;
-    if (pthread_condattr_init(&cattr) != 0 ||
-        pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC) != 0 ||
-        pthread_cond_init(&state.cond, &cattr) != 0) {
-        fprintf(stderr, "Failed to initialize condition variable.\n");
-        pthread_condattr_destroy(&cattr);
-        goto cleanup;
+    if (event_loop_mode) {
+        if (event_loop_init(&loop) < 0 || event_loop_set_input(&loop, tp.input_fd) < 0) {
+            fprintf(stderr, "Failed to initialize event loop: %s\n", strerror(errno));
+            goto cleanup;
+        }
+    } else {
+        if (pthread_create(&thr, NULL, pulser_thread, (void *)(intptr_t)emitter.ufd) != 0) {
+            fprintf(stderr, "Failed to create pulser thread.\n");
+            goto cleanup;
+        }
+        thread_started = 1;
+        // The pulser owns the device from here on and destroys it when it exits.
+        emitter.ufd = -1;
     }
-    pthread_condattr_destroy(&cattr);
-    cond_initialized = 1;
 
-    pthread_t thr;
-    int thread_started = 0;
-    if (pthread_create(&thr, NULL, pulser_thread, (void *)(intptr_t)ufd) != 0) {
-        fprintf(stderr, "Failed to create pulser thread.\n");
-        goto cleanup;
+    if (thread_started) {
+        clockid_t clock;
+        if (pthread_getcpuclockid(thr, &clock) == 0) {
+            atomic_store_explicit(&thread_clocks.pulser, clock, memory_order_relaxed);
+            atomic_store_explicit(&thread_clocks.has_pulser, 1, memory_order_release);
+        }
+    }
+
+    if (metrics_socket_path) {
+        if (metrics_server_start(&metrics, metrics_socket_path) < 0) {
+            fprintf(stderr, "Failed to start metrics socket %s: %s\n", metrics_socket_path, strerror(errno));
+            goto cleanup;
+        }
     }
-    thread_started = 1;
 
-    int last_x = -1, last_y = -1;
-    int current_slot = 0;
-    int preferred_slot = -1;
-    int was_in_edge = 0;
-    int was_in_edge_x = 0;
-    int was_in_edge_y = 0;
     int touchpad_available = 1;
     int64_t next_reopen_at_ms = INT64_MAX;
+    int reopen_retries_left = 0;
     struct resource_guard_state resource_guard = {0};
-    int slot_count = 1;
-    int active_fingers = 0;
     int pressure_min = 0, pressure_max = 0;
-    int last_pressure = -1;
     int invalid_axes_logged = 0;
-    struct timespec edge_enter_time = {0};
-    int has_mt_tracking_id = libevdev_has_event_code(tp.dev, EV_ABS, ABS_MT_TRACKING_ID);
-    int has_btn_touch = libevdev_has_event_code(tp.dev, EV_KEY, BTN_TOUCH);
-    int has_touch_tool_keys =
-        libevdev_has_event_code(tp.dev, EV_KEY, BTN_TOOL_FINGER) ||
-        libevdev_has_event_code(tp.dev, EV_KEY, BTN_TOOL_DOUBLETAP) ||
-        libevdev_has_event_code(tp.dev, EV_KEY, BTN_TOOL_TRIPLETAP) ||
-        libevdev_has_event_code(tp.dev, EV_KEY, BTN_TOOL_QUADTAP) ||
-        libevdev_has_event_code(tp.dev, EV_KEY, BTN_TOOL_QUINTTAP);
-    int has_touch_contact_key = has_btn_touch || has_touch_tool_keys;
-    int touch_contact = 0;
-    int touchpad_buttons_down_mask = 0;
-    int double_tap_active = 0;
-    int64_t last_tap_time_ms = 0;
-    int tap_count = 0;
-    int tap_start_x = -1, tap_start_y = -1;
+    int64_t edge_enter_ms = 0;
+    // When the frame being classified was read, for --latency-stats.
+    int64_t frame_read_ns = 0;
 
+    read_touch_capabilities(tp.dev, &tt);
+    reset_touch_tracker(&tt);
     read_pressure_range(tp.dev, &pressure_min, &pressure_max);
 
-    if (reset_multitouch_state(tp.dev, &slot_x, &slot_y, &slot_active, &slot_count) < 0) {
+    if (reset_multitouch_state(tp.dev, &tt) < 0) {
         fprintf(stderr, "Failed to allocate multitouch state memory.\n");
         goto cleanup;
     }
 
-    struct pollfd pfd = {.fd = tp.input_fd, .events = POLLIN};
+    if (hotplug_monitor_open(&hotplug) < 0) {
+        if (verbose)
+            fprintf(stderr, "udev monitor unavailable, falling back to reconnect polling.\n");
+    } else if (event_loop_mode && event_loop_watch(&loop, hotplug.fd) < 0) {
+        hotplug_monitor_close(&hotplug);
+    }
+
+    struct pollfd pfd[2] = {
+        {.fd = tp.input_fd, .events = POLLIN},
+        {.fd = hotplug.fd, .events = POLLIN},
+    };
+    int nfds = hotplug.fd >= 0 ? 2 : 1;
     int read_flags = LIBEVDEV_READ_FLAG_NORMAL;
+    int reclassify = 1;
+    int should_active = 0;
+    int dx = 0, dy = 0;
+    int64_t hold_deadline_ms = INT64_MAX;
+    // The pending deadline ends a --button-cooldown-ms rather than a --hold-ms delay.
+    int cooldown_deadline = 0;
+    int64_t classify_time_ms = monotonic_now_ms();
 
     while (running) {
-        if (check_resource_limits(&resource_guard) < 0) {
-            running = 0;
-            break;
-        }
-
-        // Automatic tap count reset after window expires
-        if (double_tap_hold_mode && tap_count > 0 && !touch_contact) {
-            int64_t now_ms = monotonic_now_ms();
-            if ((now_ms - last_tap_time_ms) > double_tap_max_window_ms) {
-                tap_count = 0;
+        if (!event_loop_mode) {
+            int guard_action = check_resource_limits(&resource_guard);
+            if (guard_action == GUARD_RESTART_EMITTER && restart_pulser(&thr, &resource_guard) < 0) {
+                fprintf(stderr, "Failed to restart the pulser thread.\n");
+                thread_started = 0;
+                guard_action = GUARD_STOP;
+            }
+            if (guard_action == GUARD_STOP) {
+                running = 0;
+                break;
             }
         }
 
-        int should_active = 0;
-        int dx = 0, dy = 0;
-        int64_t edge_diff_ms = 0;
-
-        double speed_factor = 0.0;
-        int touch_contact_active = 0;
-        if (has_mt_tracking_id)
-            touch_contact_active = active_fingers > 0;
-        else if (has_touch_contact_key)
-            touch_contact_active = touch_contact;
-        else
-            touch_contact_active = (last_x >= 0 && last_y >= 0);
-
-        int two_finger_ok = !(mode == EM_MODE_SCROLL && two_finger_scroll) || active_fingers >= 2;
-        if (max_x <= min_x || max_y <= min_y) {
-            if (verbose && !invalid_axes_logged) {
-                fprintf(stderr,
-                        "Invalid touchpad axis range [%d..%d]x[%d..%d], waiting for recovery...\n",
-                        min_x,
-                        max_x,
-                        min_y,
-                        max_y);
-                invalid_axes_logged = 1;
-            }
-            deactivate_edge_motion();
-            last_x = -1;
-            last_y = -1;
-            (void)poll(NULL, 0, RESOURCE_CHECK_INTERVAL_MS);
-            continue;
+        if (latency_dump_requested) {
+            latency_dump_requested = 0;
+            dump_latency_stats(stderr);
         }
-        invalid_axes_logged = 0;
-
-        // Double-tap hold mode: only activate edge-scrolling after double-tap and while finger is held
-        if (double_tap_hold_mode) {
-            // If the finger IS touching, but we are not in double-tap-hold session yet,
-            // we DEACTIVATE the edge scrolling (it won't move), but we DO NOT reset last_x/y.
-            // This allows us to track coordinates for tap detection.
-            if (!touch_contact_active || !double_tap_active || !two_finger_ok) {
-                deactivate_edge_motion();
-                // was_in_edge is set to 0 to prevent "sliding in" from old state
-                was_in_edge = 0;
-                was_in_edge_x = 0;
-                was_in_edge_y = 0;
-            }
-        } else {
-            // Normal mode: edge-scrolling works when no buttons are pressed
-            if (!touch_contact_active || touchpad_buttons_down_mask != 0 || !two_finger_ok) {
-                deactivate_edge_motion();
-                was_in_edge = 0;
-                was_in_edge_x = 0;
-                was_in_edge_y = 0;
-            }
+        if (flight_dump_requested) {
+            flight_dump_requested = 0;
+            flight_dump("SIGUSR2");
         }
 
-        if (last_x >= 0 && last_y >= 0) {
-            double nx = (double)(last_x - min_x) / (double)(max_x - min_x);
-            double ny = (double)(last_y - min_y) / (double)(max_y - min_y);
-            if (nx > 0.5 - deadzone && nx < 0.5 + deadzone)
-                nx = 0.5;
-            if (ny > 0.5 - deadzone && ny < 0.5 + deadzone)
-                ny = 0.5;
-            double depth_x = 0.0;
-            double depth_y = 0.0;
-
-            double left_enter = threshold_left;
-            double right_enter = threshold_right;
-            double top_enter = threshold_top;
-            double bottom_enter = threshold_bottom;
-            double left_leave = left_enter - edge_hysteresis;
-            double right_leave = right_enter - edge_hysteresis;
-            double top_leave = top_enter - edge_hysteresis;
-            double bottom_leave = bottom_enter - edge_hysteresis;
-
-            if (was_in_edge_x) {
-                if (nx >= 1.0 - right_leave)
-                    dx = 1;
-                else if (nx <= left_leave)
-                    dx = -1;
+        // Edge state only changes with a new touch frame or when a hold delay runs out; pulse
+        // timing belongs to the emitter, so nothing else needs to rerun the classification.
+        // Frames are timed by their kernel timestamp, an expired hold by the clock.
+        if (!reclassify && hold_deadline_ms != INT64_MAX) {
+            int64_t now_ms = monotonic_now_ms();
+            if (now_ms >= hold_deadline_ms) {
+                if (cooldown_deadline)
+                    EM_PROBE1(cooldown_end, now_ms - hold_deadline_ms);
+                else
+                    EM_PROBE1(hold_fire, now_ms - hold_deadline_ms);
+                reclassify = 1;
+                classify_time_ms = now_ms;
             }
+        }
 
-            if (!dx) {
-                if (nx >= 1.0 - right_enter)
-                    dx = 1;
-                else if (nx <= left_enter)
-                    dx = -1;
+        if (reclassify) {
+            reclassify = 0;
+            should_active = 0;
+            dx = 0;
+            dy = 0;
+            hold_deadline_ms = INT64_MAX;
+            cooldown_deadline = 0;
+
+            double speed_factor = 0.0;
+            enum em_mode emit_mode = mode;
+            double speed_scale = 1.0;
+            int touch_contact_active = 0;
+            if (tt.has_mt_tracking_id)
+                touch_contact_active = tt.active_fingers > 0;
+            else if (tt.has_touch_contact_key)
+                touch_contact_active = tt.touch_contact;
+            else
+                touch_contact_active = (tt.last_x >= 0 && tt.last_y >= 0);
+
+            int two_finger_ok = !(mode == EM_MODE_SCROLL && two_finger_scroll) || tt.active_fingers >= 2;
+            if (max_x <= min_x || max_y <= min_y) {
+                if (verbose && !invalid_axes_logged) {
+                    fprintf(stderr,
+                            "Invalid touchpad axis range [%d..%d]x[%d..%d], waiting for recovery...\n",
+                            min_x,
+                            max_x,
+                            min_y,
+                            max_y);
+                    invalid_axes_logged = 1;
+                }
+                deactivate_edge_motion();
+                tt.last_x = -1;
+                tt.last_y = -1;
+                if (event_loop_mode) {
+                    // The hotplug fd stays in the level-triggered epoll set, so pending uevents
+                    // have to be drained here or every wait returns at once.
+                    event_loop_set_input(&loop, -1);
+                    int ready = event_loop_wait(&loop, &emitter, RESOURCE_CHECK_INTERVAL_MS, &pfd[1], nfds - 1,
+                                                &resource_guard);
+                    if (ready > 0 && (pfd[1].revents & POLLIN))
+                        (void)hotplug_monitor_touchpad_added(&hotplug);
+                } else {
+                    (void)poll(NULL, 0, RESOURCE_CHECK_INTERVAL_MS);
+                }
+                reclassify = 1;
+                continue;
             }
-
-            if (was_in_edge_y) {
-                if (ny >= 1.0 - bottom_leave)
-                    dy = 1;
-                else if (ny <= top_leave)
-                    dy = -1;
+            invalid_axes_logged = 0;
+
+            // Double-tap hold mode: only activate edge-scrolling after double-tap and while finger is held
+            if (double_tap_hold_mode) {
+                // If the finger IS touching, but we are not in double-tap-hold session yet,
+                // we DEACTIVATE the edge scrolling (it won't move), but we DO NOT reset last_x/y.
+                // This allows us to track coordinates for tap detection.
+                if (!touch_contact_active || !tt.double_tap_active || !two_finger_ok) {
+                    deactivate_edge_motion();
+                    // was_in_edge is set to 0 to prevent "sliding in" from old state
+                    tt.was_in_edge = 0;
+                    tt.was_in_edge_x = 0;
+                    tt.was_in_edge_y = 0;
+                }
+            } else {
+                // Normal mode: edge-scrolling works when no buttons are pressed
+                if (!touch_contact_active || tt.buttons_down_mask != 0 || !two_finger_ok) {
+                    deactivate_edge_motion();
+                    tt.was_in_edge = 0;
+                    tt.was_in_edge_x = 0;
+                    tt.was_in_edge_y = 0;
+                }
             }
 
-            if (!dy) {
-                if (ny >= 1.0 - bottom_enter)
-                    dy = 1;
-                else if (ny <= top_enter)
-                    dy = -1;
-            }
+            if (tt.last_x >= 0 && tt.last_y >= 0) {
+                int depth_x = 0;
+                int depth_y = 0;
+                dx = classify_edge_axis(&edge_table.x, tt.last_x, tt.was_in_edge_x, &depth_x);
+                dy = classify_edge_axis(&edge_table.y, tt.last_y, tt.was_in_edge_y, &depth_y);
+
+                // Zones override the four edges where they apply; an exclude zone clears them.
+                const struct edge_zone *zone = lookup_zone(tt.last_x, tt.last_y);
+                if (zone) {
+                    dx = zone->dx;
+                    dy = zone->dy;
+                    if (zone->mode >= 0)
+                        emit_mode = (enum em_mode)zone->mode;
+                    speed_scale = zone->speed;
+                }
 
-            if (nx >= 1.0 - right_enter)
-                depth_x = (nx - (1.0 - right_enter)) / right_enter;
-            else if (nx <= left_enter)
-                depth_x = (left_enter - nx) / left_enter;
-
-            if (ny >= 1.0 - bottom_enter)
-                depth_y = (ny - (1.0 - bottom_enter)) / bottom_enter;
-            else if (ny <= top_enter)
-                depth_y = (top_enter - ny) / top_enter;
-
-            if (depth_x > 1.0)
-                depth_x = 1.0;
-            if (depth_y > 1.0)
-                depth_y = 1.0;
-
-            speed_factor = fmax(depth_x, depth_y);
-            if (accel_exponent != 1.0 && speed_factor > 0.0)
-                speed_factor = pow(speed_factor, accel_exponent);
-            if (pressure_boost > 0.0 && pressure_max > pressure_min && last_pressure >= pressure_min) {
-                double p = (double)(last_pressure - pressure_min) / (double)(pressure_max - pressure_min);
-                if (p < 0.0)
-                    p = 0.0;
-                if (p > 1.0)
-                    p = 1.0;
-                speed_factor *= 1.0 + p * pressure_boost;
-                if (speed_factor > 1.0)
-                    speed_factor = 1.0;
-            }
+                // No activation over the physical buttons or right after a click; an expired
+                // cooldown is picked up like a hold deadline.
+                if (tt.last_y >= edge_table.button_zone_y) {
+                    dx = 0;
+                    dy = 0;
+                } else if (classify_time_ms < tt.button_cooldown_until_ms) {
+                    dx = 0;
+                    dy = 0;
+                    hold_deadline_ms = tt.button_cooldown_until_ms;
+                    cooldown_deadline = 1;
+                }
 
-            int currently_in_edge = (dx != 0 || dy != 0);
-            if (currently_in_edge && (!double_tap_hold_mode || double_tap_active)) {
-                struct timespec now;
-                clock_gettime(CLOCK_MONOTONIC, &now);
-                if (!was_in_edge) {
-                    edge_enter_time = now;
-                    was_in_edge = 1;
+                int64_t speed = accel_lookup(depth_x > depth_y ? depth_x : depth_y);
+                if (pressure_boost > 0.0 && pressure_max > pressure_min && tt.last_pressure >= pressure_min) {
+                    int64_t p = (int64_t)(tt.last_pressure - pressure_min) * (SPEED_LUT_SIZE - 1) /
+                                (pressure_max - pressure_min);
+                    if (p > SPEED_LUT_SIZE - 1)
+                        p = SPEED_LUT_SIZE - 1;
+                    speed = (speed * pressure_lut[p]) >> EDGE_DEPTH_SHIFT;
+                    if (speed > EDGE_DEPTH_ONE)
+                        speed = EDGE_DEPTH_ONE;
+                }
+                speed_factor = (double)speed / EDGE_DEPTH_ONE;
+
+                int currently_in_edge = (dx != 0 || dy != 0);
+                if (currently_in_edge && (!double_tap_hold_mode || tt.double_tap_active)) {
+                    if (!tt.was_in_edge) {
+                        edge_enter_ms = classify_time_ms;
+                        tt.was_in_edge = 1;
+                        EM_PROBE2(hold_start, dx, dy);
+                    }
+                    should_active = classify_time_ms - edge_enter_ms >= hold_ms;
+                    if (!should_active)
+                        hold_deadline_ms = edge_enter_ms + hold_ms;
+                } else {
+                    tt.was_in_edge = 0;
                 }
-                edge_diff_ms = timespec_to_ms(&now) - timespec_to_ms(&edge_enter_time);
-                should_active = edge_diff_ms >= hold_ms;
+
+                tt.was_in_edge_x = (dx != 0);
+                tt.was_in_edge_y = (dy != 0);
             } else {
-                was_in_edge = 0;
+                tt.was_in_edge = 0;
+                tt.was_in_edge_x = 0;
+                tt.was_in_edge_y = 0;
             }
 
-            was_in_edge_x = (dx != 0);
-            was_in_edge_y = (dy != 0);
-        } else {
-            was_in_edge = 0;
-            was_in_edge_x = 0;
-            was_in_edge_y = 0;
+            publish_edge_state(should_active, dx, dy, speed_factor, emit_mode, speed_scale);
+            if (frame_read_ns) {
+                latency_record(LAT_READ_TO_CLASSIFY, monotonic_now_ns() - frame_read_ns);
+                frame_read_ns = 0;
+            }
         }
 
-        pthread_mutex_lock(&state.lock);
-        int changed = (state.edge_active != should_active || state.dir_x != dx || state.dir_y != dy ||
-                       fabs(state.speed_factor - speed_factor) > 0.0001);
-        state.edge_active = should_active;
-        state.dir_x = dx;
-        state.dir_y = dy;
-        state.speed_factor = speed_factor;
-        if (changed)
-            pthread_cond_signal(&state.cond);
-        pthread_mutex_unlock(&state.lock);
-
         int timeout_ms = -1;
-        if (should_active) {
-            timeout_ms = pulse_ms;
-        } else if (dx || dy) {
-            int remaining = hold_ms - (int)edge_diff_ms;
-            timeout_ms = remaining > 0 ? remaining : 0;
+        if (hold_deadline_ms != INT64_MAX) {
+            int64_t remaining = hold_deadline_ms - monotonic_now_ms();
+            timeout_ms = remaining > 0 ? (int)remaining : 0;
         }
 
         if (!touchpad_available) {
+            // With a udev monitor the reopen waits for an "add" uevent instead of a deadline.
             int64_t now_ms = monotonic_now_ms();
             int64_t remaining = next_reopen_at_ms - now_ms;
-            timeout_ms = remaining > 0 ? (int)remaining : 0;
+            if (next_reopen_at_ms == INT64_MAX)
+                timeout_ms = -1;
+            else
+                timeout_ms = remaining > 0 ? (int)remaining : 0;
+        }
+
+        // The guard has to sample even while the touchpad is idle, or a spinning pulser would
+        // go unnoticed; --event-loop has its own timerfd for that.
+        if (!event_loop_mode && resource_guard_enabled && resource_guard.initialized) {
+            int64_t due = timespec_to_ms(&resource_guard.last_ts) + RESOURCE_CHECK_INTERVAL_MS - monotonic_now_ms();
+            int guard_timeout = due > 0 ? (int)due : 0;
+            if (timeout_ms < 0 || guard_timeout < timeout_ms)
+                timeout_ms = guard_timeout;
         }
 
-        int ret = touchpad_available ? poll(&pfd, 1, timeout_ms) : poll(NULL, 0, timeout_ms);
+        int ret;
+        if (event_loop_mode)
+            ret = event_loop_wait(&loop, &emitter, timeout_ms, pfd, nfds, &resource_guard);
+        else
+            ret = poll(pfd, (nfds_t)nfds, timeout_ms);
+        atomic_fetch_add_explicit(&input_stats.wakeups, 1, memory_order_relaxed);
         if (ret < 0) {
             if (errno == EINTR)
                 continue;
             break;
         }
 
-        if (ret > 0) {
+        int touchpad_added = 0;
+        if (ret > 0 && hotplug.fd >= 0 && (pfd[1].revents & POLLIN))
+            touchpad_added = hotplug_monitor_touchpad_added(&hotplug);
+
+        if (ret > 0 && pfd[0].revents) {
             int rc = -EAGAIN;
             int sync_received = 0;
 
-            if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            if (pfd[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
                 rc = -ENODEV;
-            } else if (pfd.revents & POLLIN) {
-                struct input_event ev;
-
-                while ((rc = libevdev_next_event(tp.dev, read_flags, &ev)) >= 0) {
-                    if (rc == LIBEVDEV_READ_STATUS_SYNC)
-                        read_flags = LIBEVDEV_READ_FLAG_SYNC;
-
-                    if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
-                        sync_received = 1;
-                        continue;
-                    }
-
-                    if (ev.type == EV_ABS) {
-                        if (ev.code == ABS_MT_SLOT)
-                            current_slot = ev.value;
-
-                        int slot_valid = current_slot >= 0 && current_slot < slot_count;
-
-                        if ((ev.code == ABS_MT_POSITION_X || ev.code == ABS_X) && slot_valid) {
-                            slot_x[current_slot] = ev.value;
-                            if (tap_start_x < 0)
-                                tap_start_x = ev.value;
-                            if (preferred_slot < 0 || preferred_slot == current_slot)
-                                preferred_slot = current_slot;
-                            if (preferred_slot == current_slot && slot_y[current_slot] >= 0)
-                                last_x = ev.value;
-                        }
-                        if ((ev.code == ABS_MT_POSITION_Y || ev.code == ABS_Y) && slot_valid) {
-                            slot_y[current_slot] = ev.value;
-                            if (tap_start_y < 0)
-                                tap_start_y = ev.value;
-                            if (preferred_slot < 0 || preferred_slot == current_slot)
-                                preferred_slot = current_slot;
-                            if (preferred_slot == current_slot && slot_x[current_slot] >= 0)
-                                last_y = ev.value;
-                        }
-
-                        if (ev.code == ABS_MT_PRESSURE || ev.code == ABS_PRESSURE)
-                            last_pressure = ev.value;
-
-                        if (ev.code == ABS_MT_TRACKING_ID && slot_valid) {
-                            if (ev.value == -1) {
-                                if (slot_active[current_slot] && active_fingers > 0)
-                                    active_fingers--;
-                                slot_active[current_slot] = 0;
-                                slot_x[current_slot] = -1;
-                                slot_y[current_slot] = -1;
-                                if (preferred_slot == current_slot)
-                                    preferred_slot = -1;
-                            } else {
-                                // Finger touched
-                                if (!slot_active[current_slot])
-                                    active_fingers++;
-                                slot_active[current_slot] = 1;
-                                preferred_slot = current_slot;
-                            }
-                        }
-                    } else if (ev.type == EV_KEY) {
-                        if (ev.code == BTN_LEFT) {
-                            if (ev.value == 0)
-                                touchpad_buttons_down_mask &= ~1;
-                            else
-                                touchpad_buttons_down_mask |= 1;
-                            // Single click cancels double-tap mode
-                            if (double_tap_hold_mode && ev.value == 1) {
-                                double_tap_active = 0;
-                                tap_count = 0;
-                                last_tap_time_ms = 0;
-                            }
-                        } else if (ev.code == BTN_RIGHT) {
-                            if (ev.value == 0)
-                                touchpad_buttons_down_mask &= ~2;
-                            else
-                                touchpad_buttons_down_mask |= 2;
-                        } else if (ev.code == BTN_MIDDLE) {
-                            if (ev.value == 0)
-                                touchpad_buttons_down_mask &= ~4;
-                            else
-                                touchpad_buttons_down_mask |= 4;
-                        }
-
-                        int touch_released = 0;
-                        if (has_btn_touch && ev.code == BTN_TOUCH) {
-                            touch_contact = ev.value > 0 ? 1 : 0;
-                            touch_released = ev.value == 0;
-
-                            if (double_tap_hold_mode) {
-                                if (ev.value == 1) { // Touch started
-                                    int64_t now_ms = monotonic_now_ms();
-                                    int64_t diff = now_ms - last_tap_time_ms;
-                                    if (tap_count == 1 && diff >= double_tap_min_window_ms && diff <= double_tap_max_window_ms) {
-                                        double_tap_active = 1;
-                                    } else {
-                                        double_tap_active = 0;
-                                        tap_count = 0;
-                                    }
-                                    tap_start_x = -1;
-                                    tap_start_y = -1;
-                                }
-                            }
-                        } else if (has_touch_tool_keys && is_touch_tool_key(ev.code)) {
-                            if (!has_btn_touch) {
-                                touch_contact = ev.value > 0 ? 1 : 0;
-                                touch_released = ev.value == 0;
-
-                                if (double_tap_hold_mode) {
-                                    if (ev.value == 1) { // Touch started
-                                        int64_t now_ms = monotonic_now_ms();
-                                    int64_t diff = now_ms - last_tap_time_ms;
-                                    if (tap_count == 1 && diff >= double_tap_min_window_ms && diff <= double_tap_max_window_ms) {
-                                        double_tap_active = 1;
-                                    } else {
-                                        double_tap_active = 0;
-                                        tap_count = 0;
-                                    }
-                                        tap_start_x = -1;
-                                        tap_start_y = -1;
-                                    }
-                                }
-                            }
+            } else if (pfd[0].revents & POLLIN) {
+                if (raw_reader_mode) {
+                    rc = read_raw_events(tp.input_fd, &raw_reader, &tt, &sync_received);
+                } else {
+                    struct input_event ev;
+
+                    while ((rc = libevdev_next_event(tp.dev, read_flags, &ev)) >= 0) {
+                        if (rc == LIBEVDEV_READ_STATUS_SYNC)
+                            read_flags = LIBEVDEV_READ_FLAG_SYNC;
+                        atomic_fetch_add_explicit(&input_stats.events, 1, memory_order_relaxed);
+
+                        if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
+                            tt.event_time_ms = event_time_ms(&ev);
+                            tt.frame_time_ns = event_time_ns(&ev);
+                            atomic_fetch_add_explicit(&input_stats.frames, 1, memory_order_relaxed);
+                            sync_received = 1;
+                            continue;
                         }
 
-                        if (touch_released) {
-                            if (double_tap_hold_mode) {
-                                int64_t now_ms = monotonic_now_ms();
-                                
-                                if (double_tap_active) {
-                                    double_tap_active = 0;
-                                    tap_count = 0;
-                                    last_tap_time_ms = 0;
-                                } else {
-                                    // Any short release within window counts as potential first tap
-                                    tap_count = 1;
-                                    last_tap_time_ms = now_ms;
-                                }
-                            }
-
-                            last_x = -1;
-                            last_y = -1;
-                            last_pressure = -1;
-                            was_in_edge = 0;
-                            was_in_edge_x = 0;
-                            was_in_edge_y = 0;
-                            preferred_slot = -1;
-                            if (!has_mt_tracking_id) {
-                                active_fingers = 0;
-                                for (int i = 0; i < slot_count; i++) {
-                                    slot_active[i] = 0;
-                                    slot_x[i] = -1;
-                                    slot_y[i] = -1;
-                                }
-                            }
-                        }
+                        process_touch_event(&tt, &ev);
                     }
-                }
 
-                if (rc == -EAGAIN && read_flags == LIBEVDEV_READ_FLAG_SYNC)
-                    read_flags = LIBEVDEV_READ_FLAG_NORMAL;
+                    if (rc == -EAGAIN && read_flags == LIBEVDEV_READ_FLAG_SYNC)
+                        read_flags = LIBEVDEV_READ_FLAG_NORMAL;
+                }
             }
 
             if (sync_received) {
-                int active_slot = -1;
-                if (preferred_slot >= 0 && preferred_slot < slot_count && slot_active[preferred_slot] &&
-                    slot_x[preferred_slot] >= 0 && slot_y[preferred_slot] >= 0)
-                    active_slot = preferred_slot;
-                else {
-                    for (int i = 0; i < slot_count; i++) {
-                        if (slot_active[i] && slot_x[i] >= 0 && slot_y[i] >= 0) {
-                            active_slot = i;
-                            break;
-                        }
-                    }
-                }
-
-                if (active_slot >= 0) {
-                    last_x = slot_x[active_slot];
-                    last_y = slot_y[active_slot];
-                } else if (has_mt_tracking_id) {
-                    last_x = -1;
-                    last_y = -1;
+                if (latency_stats) {
+                    frame_read_ns = monotonic_now_ns();
+                    if (tt.frame_time_ns)
+                        latency_record(LAT_EVDEV_TO_READ, frame_read_ns - tt.frame_time_ns);
                 }
+                finish_touch_frame(&tt);
+                reclassify = 1;
+                classify_time_ms = tt.event_time_ms;
             }
             if (rc < 0 && rc != -EAGAIN) {
+                EM_PROBE1(touchpad_disconnect, -rc);
                 if (verbose)
                     fprintf(stderr, "Touchpad disconnected, reconnecting...\n");
 
                 deactivate_edge_motion();
 
-                last_x = -1;
-                last_y = -1;
-                was_in_edge = 0;
-                was_in_edge_x = 0;
-                was_in_edge_y = 0;
+                reset_touch_contact(&tt);
+                reclassify = 1;
+                classify_time_ms = monotonic_now_ms();
                 touchpad_available = 0;
-                active_fingers = 0;
-                touch_contact = 0;
-                touchpad_buttons_down_mask = 0;
-                double_tap_active = 0;
-                tap_count = 0;
-                last_tap_time_ms = 0;
-                tap_start_x = -1;
-                tap_start_y = -1;
+                if (event_loop_mode)
+                    event_loop_set_input(&loop, -1);
                 cleanup_touchpad_resources(&tp);
-                pfd.fd = -1;
+                pfd[0].fd = -1;
                 struct timespec now;
                 clock_gettime(CLOCK_MONOTONIC, &now);
                 next_reopen_at_ms = timespec_to_ms(&now) + TOUCHPAD_DISCONNECT_TIMEOUT_MS;
+                reopen_retries_left = TOUCHPAD_HOTPLUG_RETRIES;
             }
         }
 
         if (!touchpad_available && running) {
             int64_t now_ms = monotonic_now_ms();
-            if (now_ms >= next_reopen_at_ms) {
-                if (reopen_touchpad(&tp, &min_x, &max_x, &min_y, &max_y) == 0) {
+            if (touchpad_added)
+                reopen_retries_left = TOUCHPAD_HOTPLUG_RETRIES;
+            if (touchpad_added || now_ms >= next_reopen_at_ms) {
+                int reopened = reopen_touchpad(&tp, &min_x, &max_x, &min_y, &max_y) == 0;
+                if (reopened) {
                     read_pressure_range(tp.dev, &pressure_min, &pressure_max);
-                    has_mt_tracking_id = libevdev_has_event_code(tp.dev, EV_ABS, ABS_MT_TRACKING_ID);
-                    has_btn_touch = libevdev_has_event_code(tp.dev, EV_KEY, BTN_TOUCH);
-                    has_touch_tool_keys =
-                        libevdev_has_event_code(tp.dev, EV_KEY, BTN_TOOL_FINGER) ||
-                        libevdev_has_event_code(tp.dev, EV_KEY, BTN_TOOL_DOUBLETAP) ||
-                        libevdev_has_event_code(tp.dev, EV_KEY, BTN_TOOL_TRIPLETAP) ||
-                        libevdev_has_event_code(tp.dev, EV_KEY, BTN_TOOL_QUADTAP) ||
-                        libevdev_has_event_code(tp.dev, EV_KEY, BTN_TOOL_QUINTTAP);
-                    has_touch_contact_key = has_btn_touch || has_touch_tool_keys;
-
-                    if (reset_multitouch_state(tp.dev, &slot_x, &slot_y, &slot_active, &slot_count) < 0) {
+                    read_touch_capabilities(tp.dev, &tt);
+
+                    if (reset_multitouch_state(tp.dev, &tt) < 0) {
                         fprintf(stderr, "Failed to refresh multitouch state after reconnect.\n");
                         running = 0;
                         break;
                     }
 
+                    atomic_fetch_add_explicit(&input_stats.reconnects, 1, memory_order_relaxed);
+                    EM_PROBE1(touchpad_reconnect, tp.devnode);
                     if (verbose)
                         fprintf(stderr, "Touchpad reconnected: %s\n", tp.devnode);
 
+                    if (event_loop_mode && event_loop_set_input(&loop, tp.input_fd) < 0) {
+                        fprintf(stderr, "Failed to watch touchpad after reconnect.\n");
+                        running = 0;
+                        break;
+                    }
+
                     touchpad_available = 1;
-                    pfd.fd = tp.input_fd;
-                    pfd.events = POLLIN;
-                    pfd.revents = 0;
+                    pfd[0].fd = tp.input_fd;
+                    pfd[0].events = POLLIN;
+                    pfd[0].revents = 0;
                     read_flags = LIBEVDEV_READ_FLAG_NORMAL;
-                    current_slot = 0;
-                    preferred_slot = -1;
-                    active_fingers = 0;
-                    touch_contact = 0;
-                    touchpad_buttons_down_mask = 0;
-                    double_tap_active = 0;
-                    tap_count = 0;
-                    last_tap_time_ms = 0;
-                    tap_start_x = -1;
-                    tap_start_y = -1;
-                    last_pressure = -1;
-                    last_x = -1;
-                    last_y = -1;
-                    was_in_edge = 0;
-                    was_in_edge_x = 0;
-                    was_in_edge_y = 0;
-                    edge_enter_time = (struct timespec){0};
+                    raw_reader.dropped = 0;
+                    reset_touch_tracker(&tt);
+                    edge_enter_ms = 0;
+                    reclassify = 1;
+                    classify_time_ms = monotonic_now_ms();
+                }
+                if (hotplug.fd < 0) {
+                    next_reopen_at_ms = now_ms + TOUCHPAD_REOPEN_POLL_MS;
+                } else if (!reopened && reopen_retries_left > 0) {
+                    int attempt = TOUCHPAD_HOTPLUG_RETRIES - reopen_retries_left--;
+                    next_reopen_at_ms = now_ms + ((int64_t)TOUCHPAD_HOTPLUG_RETRY_MS << attempt);
+                } else {
+                    next_reopen_at_ms = INT64_MAX;
                 }
-                next_reopen_at_ms = now_ms + TOUCHPAD_REOPEN_POLL_MS;
             }
         }
     }
@@ -1910,31 +4854,52 @@ int main(int argc, char **argv)
 cleanup:
     running = 0;
 
-    if (cond_initialized) {
-        pthread_mutex_lock(&state.lock);
-        pthread_cond_broadcast(&state.cond);
-        pthread_mutex_unlock(&state.lock);
-    }
+    if (metrics_socket_path)
+        metrics_server_stop(&metrics, metrics_socket_path);
 
-    if (thread_started)
+    if (thread_started) {
+        atomic_store_explicit(&thread_clocks.has_pulser, 0, memory_order_release);
+        wake_pulser();
         pthread_join(thr, NULL);
+    }
 
-    if (!thread_started && ufd >= 0) {
-        ioctl(ufd, UI_DEV_DESTROY);
-        close(ufd);
+    destroy_uinput_device(&emitter.ufd);
+    if (statm_fd >= 0)
+        close(statm_fd);
+    statm_fd = -1;
+
+    if (verbose) {
+        fprintf(stderr,
+                "uinput: %llu events in %llu write() calls (%llu EAGAIN retries, %llu errors)\n",
+                (unsigned long long)atomic_load(&emit_stats.events),
+                (unsigned long long)atomic_load(&emit_stats.write_calls),
+                (unsigned long long)atomic_load(&emit_stats.eagain_retries),
+                (unsigned long long)atomic_load(&emit_stats.write_errors));
+        fprintf(stderr, "pulse scheduler: %llu late ticks skipped\n",
+                (unsigned long long)atomic_load(&emit_stats.skipped_ticks));
+        if (catch_up_mode)
+            fprintf(stderr, "catch-up: %llu stale events skipped\n", (unsigned long long)raw_reader.coalesced);
     }
+    if (latency_stats)
+        dump_latency_stats(stderr);
+
+    event_loop_close(&loop);
+    hotplug_monitor_close(&hotplug);
 
     cleanup_touchpad_resources(&tp);
-    free(slot_x);
-    free(slot_y);
-    free(slot_active);
+    free_multitouch_state(&tt);
     free(forced_devnode);
     forced_devnode = NULL;
+    free(device_cache_path);
+    device_cache_path = NULL;
+    free(metrics_socket_path);
+    metrics_socket_path = NULL;
+    free(flight_recorder);
+    flight_recorder = NULL;
+    free(flight_record_path);
+    flight_record_path = NULL;
     free_ignored_devnodes();
-
-    pthread_mutex_destroy(&state.lock);
-    if (cond_initialized)
-        pthread_cond_destroy(&state.cond);
+    free_zones();
 
     return 0;
 }